@@ -0,0 +1,618 @@
+/**
+ * Host micro-benchmarks for WiFiManager hot paths.
+ *
+ * Runs WiFiManager.cpp against the stand-ins in bench/stubs on a Linux host
+ * and prints one JSON object per line:
+ *   {"name":..., "iters":..., "ns_per_op":..., "allocs_per_op":...,
+ *    "bytes_per_op":..., "nvs_writes_per_op":...}
+ *
+ * Build & run:
+ *   pio run -e native_bench && .pio/build/native_bench/program
+ * or without PlatformIO:
+ *   g++ -std=gnu++17 -O2 -Isrc -Ibench/stubs -DWM_SCAN_MAX_RESULTS=100 \
+ *       bench/bench_main.cpp bench/stubs/stubs.cpp src/WiFiManager.cpp \
+ *       src/WM_LinkHistory.cpp src/WM_Log.cpp src/WM_Arena.cpp src/WM_OTA.cpp \
+ *       src/WM_Provision.cpp -lpthread -lz -o wm_bench \
+ *       && ./wm_bench > bench_output.txt
+ *
+ * With --pty [units] it instead simulates a production line for serial
+ * provisioning: it prints a pseudo-terminal path and serves each unit
+ * (fresh NVS, next MAC) behind it, e.g.
+ *   ./wm_bench --pty 200 &
+ *   python3 tools/wm_provision.py /dev/pts/N --network Line:secret --units 200
+ *
+ * Timings are host numbers: compare them between commits, not with the
+ * ESP32. Allocation counts include every operator new made by the code
+ * under test (std::string backs the stub String, so short-string behaviour
+ * is close to the Arduino core's).
+ */
+
+#include "WebAssets.h"
+#include "WiFiManager.h"
+#include <Preferences.h>
+#include <Update.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <new>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+// --- Allocation accounting ---
+static std::atomic<unsigned long> gAllocs{0};
+static std::atomic<unsigned long> gAllocBytes{0};
+
+void *operator new(size_t n) {
+  gAllocs++;
+  gAllocBytes += n;
+  if (void *p = malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+// Out of line: inlined into a caller, GCC pairs the free() with the
+// new-expression and warns (-Wmismatched-new-delete)
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { ::operator delete(p); }
+
+// Keeps results alive so the optimiser cannot drop the work
+static volatile size_t gSink = 0;
+
+template <typename F> static void bench(const char *name, F fn) {
+  using clock = std::chrono::steady_clock;
+
+  // Warm up, then grow the batch until it runs for ~100 ms
+  fn();
+  unsigned long iters = 1;
+  double ns = 0;
+  unsigned long allocs = 0, bytes = 0, nvs = 0;
+  while (true) {
+    unsigned long nvs0 = benchNvs.writes + benchNvs.erases;
+    gAllocs = 0;
+    gAllocBytes = 0;
+    auto t0 = clock::now();
+    for (unsigned long i = 0; i < iters; ++i)
+      fn();
+    auto t1 = clock::now();
+    allocs = gAllocs;
+    bytes = gAllocBytes;
+    nvs = benchNvs.writes + benchNvs.erases - nvs0;
+    ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    if (ns > 100e6 || iters >= (1UL << 24))
+      break;
+    iters *= 2;
+  }
+
+  printf("{\"name\":\"%s\",\"iters\":%lu,\"ns_per_op\":%.1f,"
+         "\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f,"
+         "\"nvs_writes_per_op\":%.2f}\n",
+         name, iters, ns / iters, (double)allocs / iters,
+         (double)bytes / iters, (double)nvs / iters);
+  fflush(stdout);
+}
+
+class WiFiManagerBench {
+public:
+  WiFiManagerBench() {
+    _wm._events = xEventGroupCreate();
+    // Routes are mounted on the internal server, as in portal mode
+    _wm.enablePortalRoutes(true);
+  }
+
+  WebServer &server() { return _wm._server; }
+
+  // Runs a full channel sweep over `count` fake networks
+  void fillScan(int count) {
+    WiFi.networks.clear();
+    for (int i = 0; i < count; ++i) {
+      char ssid[33];
+      snprintf(ssid, sizeof(ssid), "Network-%03d", i);
+      WiFi.networks.push_back(
+          {ssid, (int32_t)(-40 - (i % 50)), (uint8_t)(1 + i % 13), i % 4 != 0});
+    }
+    _wm._scanCount = 0;
+    _wm.startScan();
+    while (_wm._scanChannel != 0) {
+      _wm._lastScanSlice = 0; // Skip the AP service gap on the host
+      _wm.scanStep();
+    }
+  }
+
+  void holdScan() { _wm._scanChannel = 1; } // Keep /list from re-sweeping
+
+  void seedNvs(int slots) {
+    _wm._settings.loaded = false; // Force the cache to reload
+    benchNvs.values.clear();
+    for (int i = 0; i < slots; ++i) {
+      benchNvs.values["s" + std::to_string(i)] = "Home-" + std::to_string(i);
+      benchNvs.values["p" + std::to_string(i)] = "password-" + std::to_string(i);
+    }
+  }
+
+  bool boot() { return _wm.runBoot(); }
+
+  WiFiManager &wm() { return _wm; }
+  size_t arenaPeak() { return _wm._router.arena.peak(); }
+  const WMOta &ota() { return _wm._ota; }
+  void startPortal() { _wm.startPortal(); }
+  void stopPortal() { _wm.stopPortal(); }
+
+  // Serial provisioning
+  void provisionOn(Stream &port) { _wm.enableSerialProvisioning(port); }
+  void serviceProvisioning() { _wm.serviceProvisioning(); }
+  WMProvisionBatch &stagedBatch() { return _wm._prov.batch(); }
+  void reload() { _wm._settings.loaded = false; }
+  void setBooting(bool booting) { _wm._booting = booting; }
+  void beginNetwork(const char *ssid) { _wm.beginNetwork(ssid, ""); }
+  // Committed, and the deferred test (if any) has reported
+  bool unitDone() {
+    return benchNvs.values.count("s0") && !_wm._prov.open() &&
+           _wm._provTest != WMProvision::TEST_RUNNING;
+  }
+  void nextUnit(unsigned long n) {
+    benchNvs.values.clear();
+    _wm._settings.loaded = false;
+    _wm._provTest = WMProvision::TEST_NONE;
+    _wm._shouldRestart = false;
+    _wm._shouldStopPortal = false;
+    WiFi.mac[4] = (uint8_t)(n >> 8);
+    WiFi.mac[5] = (uint8_t)n;
+  }
+
+private:
+  WiFiManager _wm;
+};
+
+// In-memory serial port: the bench queues request frames in rx, replies
+// collect in tx
+class BenchStream : public Stream {
+public:
+  std::vector<uint8_t> rx, tx;
+  size_t rxPos = 0;
+  size_t write(const uint8_t *buf, size_t n) override {
+    tx.insert(tx.end(), buf, buf + n);
+    return n;
+  }
+  int available() override { return (int)(rx.size() - rxPos); }
+  int read() override { return rxPos < rx.size() ? rx[rxPos++] : -1; }
+};
+
+// Serial port on the master side of a pseudo-terminal
+class PtyStream : public Stream {
+public:
+  explicit PtyStream(int fd) : _fd(fd) {}
+  size_t write(const uint8_t *buf, size_t n) override {
+    ssize_t w = ::write(_fd, buf, n);
+    return w < 0 ? 0 : (size_t)w;
+  }
+  int available() override {
+    int n = 0;
+    return ioctl(_fd, FIONREAD, &n) == 0 ? n : 0;
+  }
+  int read() override {
+    uint8_t c;
+    return ::read(_fd, &c, 1) == 1 ? c : -1;
+  }
+
+private:
+  int _fd;
+};
+
+// Request frames for one unit: every network slot, static IP, BSSID hint,
+// AP name and time settings, then COMMIT
+static std::vector<uint8_t> provisionFrames(uint8_t flags) {
+  std::vector<uint8_t> out;
+  uint8_t frame[WMProvision::MAX_FRAME];
+  auto add = [&](uint8_t type, const void *data, size_t len) {
+    size_t n = WMProvision::encode(frame, type, (const uint8_t *)data, len);
+    out.insert(out.end(), frame, frame + n);
+  };
+  add(WMProvision::BEGIN, nullptr, 0);
+  for (int i = 0; i < WM_MAX_NETWORKS; i++) {
+    char net[64];
+    int n = snprintf(net, sizeof(net), "%cFactory-%d%cpassword-%d", i, i, 0, i);
+    add(WMProvision::NETWORK, net, n);
+  }
+  const uint8_t ip[16] = {10, 0, 0, 50, 10, 0, 0, 1, 255, 255, 255, 0,
+                          10, 0, 0, 1};
+  add(WMProvision::STATIC_IP, ip, sizeof(ip));
+  const uint8_t hint[7] = {0x24, 0x0A, 0xC4, 0x12, 0x34, 0x56, 6};
+  add(WMProvision::BSSID, hint, sizeof(hint));
+  add(WMProvision::AP_NAME, "Sensor-Setup", 12);
+  add(WMProvision::TIME, "time.example.com\0CET-1CEST,M3.5.0,M10.5.0/3", 44);
+  add(WMProvision::COMMIT, &flags, 1);
+  return out;
+}
+
+// Status bytes of every reply in a reply stream, in order
+static std::vector<uint8_t> replyStatus(const std::vector<uint8_t> &tx) {
+  std::vector<uint8_t> status;
+  for (size_t i = 0; i + 6 <= tx.size(); i += tx[i + 2] + 6)
+    status.push_back(tx[i + 4]);
+  return status;
+}
+
+// Simulated production line behind a pty, one fresh unit per commit
+static int runPty(WiFiManagerBench &b, unsigned long units) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) || unlockpt(master)) {
+    perror("pty");
+    return 1;
+  }
+  // Raw and held open: no echo, and no EIO while the host reconnects
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  termios tio;
+  tcgetattr(slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+  printf("%s\n", ptsname(master));
+  fflush(stdout);
+
+  PtyStream port(master);
+  b.provisionOn(port);
+  b.nextUnit(0);
+  benchSkipDelays = false;
+  unsigned long done = 0;
+  bool started = false; // Clock starts with the host's first frame
+  auto t0 = std::chrono::steady_clock::now();
+  while (!units || done < units) {
+    pollfd pfd = {master, POLLIN, 0};
+    poll(&pfd, 1, 5);
+    if (!started && port.available()) {
+      started = true;
+      t0 = std::chrono::steady_clock::now();
+    }
+    b.serviceProvisioning();
+    if (b.unitDone())
+      b.nextUnit(++done);
+  }
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                              t0)
+                    .count();
+  // Keep answering a little longer, the host may still poll the last unit
+  for (int i = 0; i < 100; i++) {
+    pollfd pfd = {master, POLLIN, 0};
+    poll(&pfd, 1, 5);
+    b.serviceProvisioning();
+  }
+  fprintf(stderr, "{\"name\":\"provision/pty\",\"units\":%lu,"
+                  "\"units_per_min\":%.0f}\n",
+          done, done * 60 / secs);
+  close(slave);
+  close(master);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  benchSkipDelays = true;
+  WiFiManagerBench b;
+  if (argc > 1 && strcmp(argv[1], "--pty") == 0)
+    return runPty(b, argc > 2 ? strtoul(argv[2], nullptr, 10) : 0);
+
+  // --- /list JSON vs compact (Accept-negotiated) payload ---
+  const std::vector<std::pair<String, String>> compact = {
+      {"Accept", "application/x-wm-scan"}};
+  for (int n : {1, 10, 25, 50, 100}) {
+    b.fillScan(n);
+    b.holdScan();
+    char name[32];
+    snprintf(name, sizeof(name), "list_json/%d", n);
+    bench(name, [&] {
+      b.server().benchRequest(HTTP_GET, "/list");
+      gSink = gSink + b.server().lastBodyLength;
+    });
+    size_t jsonBytes = b.server().lastBodyLength;
+    snprintf(name, sizeof(name), "list_compact/%d", n);
+    bench(name, [&] {
+      b.server().benchRequest(HTTP_GET, "/list", "192.168.4.1", {}, compact);
+      gSink = gSink + b.server().lastBodyLength;
+    });
+    printf("{\"name\":\"list_bytes/%d\",\"json\":%zu,\"compact\":%zu}\n", n,
+           jsonBytes, b.server().lastBodyLength);
+  }
+
+  // --- Captive-probe route dispatch ---
+  const char *probes[] = {"/generate_204", "/hotspot-detect.html",
+                          "/connecttest.txt", "/ncsi.txt", "/fwlink",
+                          "/canonical.html", "/success.txt"};
+  for (const char *uri : probes) {
+    char name[64];
+    snprintf(name, sizeof(name), "probe%s", uri);
+    bench(name, [&] {
+      b.server().benchRequest(HTTP_GET, uri);
+      gSink = gSink + b.server().lastCode;
+    });
+  }
+  bench("probe/not_found", [&] {
+    b.server().benchRequest(HTTP_GET, "/some/unknown/path");
+    gSink = gSink + b.server().lastCode;
+  });
+  bench("probe/root_foreign_host", [&] {
+    b.server().benchRequest(HTTP_GET, "/", "captive.apple.com");
+    gSink = gSink + b.server().lastCode;
+  });
+  bench("portal/root", [&] {
+    b.server().benchRequest(HTTP_GET, "/");
+    gSink = gSink + b.server().lastBodyLength;
+  });
+
+  // Shared server: with the portal on, the app's routes (even ones added
+  // after useServer()) and its not-found handler still answer
+  {
+    static WiFiManager shared;
+    WebServer app(80);
+    shared.useServer(&app);
+    app.on("/app", HTTP_GET, [&] { app.send(200, "text/plain", "app"); });
+    app.onNotFound([&] { app.send(404, "text/plain", ""); });
+    shared.enablePortalRoutes(true);
+    app.benchRequest(HTTP_GET, "/app");
+    int appCode = app.lastCode;
+    app.benchRequest(HTTP_GET, "/generate_204");
+    int probeCode = app.lastCode;
+    app.benchRequest(HTTP_GET, "/some/unknown/path");
+    printf("{\"name\":\"portal/shared_server\",\"app_route\":%d,"
+           "\"probe\":%d,\"not_found\":%d}\n",
+           appCode, probeCode, app.lastCode);
+    fflush(stdout);
+  }
+
+  // --- Credential load/save ---
+  // begin(): slot N is the first one that connects, so N+1 slots are loaded
+  b.seedNvs(3);
+  for (int slot : {0, 2}) {
+    char name[32];
+    snprintf(name, sizeof(name), "begin/connect_slot%d", slot);
+    WiFi.acceptSsid = "Home-" + std::to_string(slot);
+    bench(name, [&] { gSink = gSink + b.boot(); });
+  }
+  WiFi.acceptSsid.clear();
+  bench("save/unchanged", [&] {
+    b.server().benchRequest(HTTP_POST, "/save", "192.168.4.1",
+                            {{"ssid", "Home-2"}, {"password", "password-2"}});
+    gSink = gSink + b.server().lastCode;
+  });
+  int rotate = 0;
+  bench("save/rotate", [&] {
+    String ssid = (rotate++ & 1) ? "Home-1" : "Home-2";
+    b.server().benchRequest(HTTP_POST, "/save", "192.168.4.1",
+                            {{"ssid", ssid}, {"password", "password"}});
+    gSink = gSink + b.server().lastCode;
+  });
+  bench("error/get", [&] {
+    b.server().benchRequest(HTTP_GET, "/error");
+    gSink = gSink + b.server().lastCode;
+  });
+
+  // --- Time formatters ---
+  bench("time/now", [&] { gSink = gSink + b.wm().now().length(); });
+  bench("time/date", [&] { gSink = gSink + b.wm().date().length(); });
+  bench("time/time", [&] { gSink = gSink + b.wm().time().length(); });
+
+  // --- Link history sampling (must not allocate) ---
+  WMLinkHistory history;
+  history.begin();
+  uint32_t clock = 0;
+  bench("link/add", [&] {
+    WMLinkSample s = {(int8_t)(-50 - clock % 20), 6, clock / 3600, clock / 7,
+                      180000 + clock % 4096};
+    history.add(clock++, s);
+  });
+
+  // --- Deferred logger: enqueue cost, drained (and formatted) in batches ---
+  unsigned long logged = 0;
+  bench("log/printf", [&] {
+    WMLog::printf(WM_LOG_LEVEL_INFO, "[WiFiManager] Trying network %d: %s\n",
+                  (int)(logged & 3), "Home-Network");
+    if ((++logged & (WM_LOG_SLOTS / 2 - 1)) == 0)
+      WMLog::flush();
+  });
+  gSink = gSink + WMLog::dropped();
+
+  // --- Streaming OTA into the simulated partition ---
+  // 1 MB image: half random blocks, half repeated text, so gzip lands near
+  // the ~60 % a real firmware gets
+  std::vector<uint8_t> image(1 << 20);
+  uint32_t lcg = 12345;
+  for (size_t i = 0; i < image.size(); i++) {
+    lcg = lcg * 1103515245 + 12345;
+    image[i] = (i / 256) % 2 ? (uint8_t)(lcg >> 24) : "WiFiManager "[i % 12];
+  }
+  image[0] = 0xE9; // Application image magic
+
+  std::vector<uint8_t> gz(compressBound(image.size()) + 32);
+  z_stream z = {};
+  deflateInit2(&z, 9, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY); // gzip
+  z.next_in = image.data();
+  z.avail_in = image.size();
+  z.next_out = gz.data();
+  z.avail_out = gz.size();
+  deflate(&z, Z_FINISH);
+  gz.resize(z.total_out);
+  deflateEnd(&z);
+
+  b.wm().enableOTA("admin", "secret");
+  b.server().authUser = "admin";
+  b.server().authPass = "secret";
+  String sha;
+  for (const char *kind : {"raw", "gzip"}) {
+    const std::vector<uint8_t> &body = kind[0] == 'r' ? image : gz;
+    using clock = std::chrono::steady_clock;
+    unsigned long uploads = 0, allocs = 0, bytes = 0;
+    bool ok = true;
+    auto t0 = clock::now();
+    do {
+      gAllocs = 0;
+      gAllocBytes = 0;
+      b.server().benchUpload("/update", body.data(), body.size(),
+                             kind[0] == 'r' ? "fw.bin" : "fw.bin.gz",
+                             {{"sha256", sha}});
+      allocs = gAllocs;
+      bytes = gAllocBytes;
+      ok = ok && b.server().lastCode == 200 &&
+           Update.committedSize == image.size() &&
+           memcmp(Update.partition.data(), image.data(), image.size()) == 0;
+      sha = b.ota().digest(); // Later uploads verify against it
+      uploads++;
+    } while (std::chrono::duration<double>(clock::now() - t0).count() < 0.5);
+    double secs = std::chrono::duration<double>(clock::now() - t0).count();
+
+    // Everything new'd during an upload (core HTTPUpload, Update's sector
+    // buffer) is held until the end, plus the malloc'd inflate state
+    char name[32];
+    snprintf(name, sizeof(name), "ota/%s", kind);
+    printf("{\"name\":\"%s\",\"uploads\":%lu,\"upload_bytes\":%zu,"
+           "\"image_bytes\":%zu,\"kb_per_s\":%.0f,\"peak_heap_bytes\":%lu,"
+           "\"allocs_per_upload\":%lu,\"verified\":%s}\n",
+           name, uploads, body.size(), image.size(),
+           uploads * body.size() / 1024.0 / secs,
+           bytes + (unsigned long)b.ota().heapPeak(), allocs,
+           ok ? "true" : "false");
+  }
+  unsigned long committed = Update.committed;
+  b.server().benchUpload("/update", image.data(), image.size(), "fw.bin",
+                         {{"sha256", String(std::string(64, '0').c_str())}});
+  printf("{\"name\":\"ota/sha_mismatch\",\"code\":%d,\"rejected\":%s}\n",
+         b.server().lastCode, Update.committed == committed ? "true" : "false");
+
+  // Standalone mode: the portal closes, /update stays reachable on port 80
+  b.startPortal();
+  b.stopPortal();
+  b.server().benchUpload("/update", image.data(), image.size(), "fw.bin", {});
+  int updateCode = b.server().lastCode;
+  bool rootServed = b.server().benchRequest(HTTP_GET, "/", "192.168.1.20");
+  printf("{\"name\":\"ota/after_portal\",\"listening\":%s,\"update\":%d,"
+         "\"root_served\":%s}\n",
+         b.server().listening() ? "true" : "false", updateCode,
+         rootServed ? "true" : "false");
+  b.wm().enablePortalRoutes(true); // Back to portal mode for the rows below
+  fflush(stdout);
+
+  // --- Serial provisioning: one full unit per op (fresh NVS each time) ---
+  BenchStream port;
+  b.provisionOn(port);
+  const std::vector<uint8_t> unit = provisionFrames(0);
+  unsigned long opens = 0, units = 0;
+  bench("provision/unit", [&] {
+    unsigned long opens0 = benchNvs.opens;
+    b.nextUnit(0);
+    port.rx = unit;
+    port.rxPos = 0;
+    port.tx.clear();
+    b.serviceProvisioning();
+    gSink = gSink + port.tx.size();
+    opens += benchNvs.opens - opens0;
+    units++;
+  });
+  std::vector<uint8_t> status = replyStatus(port.tx);
+  bool accepted = status.size() == 9;
+  for (uint8_t s : status)
+    accepted = accepted && s == WMProvision::OK;
+  bool stored = benchNvs.values["s2"] == "Factory-2" &&
+                benchNvs.values["ap"] == "Sensor-Setup" &&
+                benchNvs.values["bssid"].size() == 7 &&
+                !benchNvs.values.count("txn");
+  // Opens per unit include the read-only settings load
+  printf("{\"name\":\"provision/unit_check\",\"request_bytes\":%zu,"
+         "\"reply_bytes\":%zu,\"nvs_opens_per_unit\":%.2f,\"accepted\":%s,"
+         "\"stored\":%s}\n",
+         unit.size(), port.tx.size(), (double)opens / units,
+         accepted ? "true" : "false", stored ? "true" : "false");
+
+  // Reset after the journal write, before any key was applied: the next
+  // load finishes the commit
+  WMProvisionBatch txn = b.stagedBatch();
+  b.nextUnit(1);
+  benchNvs.values["txn"] = std::string((const char *)&txn, sizeof(txn));
+  b.reload();
+  b.boot();
+  printf("{\"name\":\"provision/journal_replay\",\"applied\":%s}\n",
+         benchNvs.values["s0"] == "Factory-0" &&
+                 benchNvs.values["tz"] == txn.tz &&
+                 !benchNvs.values.count("txn") && WiFi.staticIp &&
+                 WiFi.bssidHint
+             ? "true"
+             : "false");
+
+  // Deferred test: COMMIT replies at once, the result follows from the
+  // next service pass
+  b.nextUnit(2);
+  port.rx = provisionFrames(WMProvision::FLAG_TEST);
+  port.rxPos = 0;
+  port.tx.clear();
+  b.serviceProvisioning();
+  size_t beforeTest = replyStatus(port.tx).size();
+  b.serviceProvisioning(); // Starts the connection
+  b.serviceProvisioning(); // Stub connects at once
+  printf("{\"name\":\"provision/deferred_test\",\"replies_at_commit\":%zu,"
+         "\"result\":%d}\n",
+         beforeTest, port.tx.size() > 2 ? port.tx[port.tx.size() - 3] : -1);
+
+  // Lost COMMIT reply: the resend is answered OK and writes nothing
+  b.nextUnit(3);
+  port.rx = unit;
+  port.rxPos = 0;
+  b.serviceProvisioning();
+  unsigned long nvs0 = benchNvs.writes + benchNvs.erases;
+  uint8_t commit[WMProvision::MAX_FRAME];
+  const uint8_t noFlags = 0;
+  size_t commitLen = WMProvision::encode(commit, WMProvision::COMMIT,
+                                         &noFlags, 1);
+  port.rx.assign(commit, commit + commitLen);
+  port.rxPos = 0;
+  port.tx.clear();
+  b.serviceProvisioning();
+  printf("{\"name\":\"provision/duplicate_commit\",\"status\":%d,"
+         "\"nvs_writes\":%lu}\n",
+         replyStatus(port.tx).empty() ? -1 : replyStatus(port.tx)[0],
+         benchNvs.writes + benchNvs.erases - nvs0);
+
+  // The hint and static IP follow Factory-0 only; a network saved from the
+  // portal takes slot 0 without them, and they are dropped from NVS
+  b.beginNetwork("Factory-1");
+  bool otherPlain = !WiFi.bssidHint && !WiFi.staticIp;
+  b.beginNetwork("Factory-0");
+  bool ownerHinted = WiFi.bssidHint && WiFi.staticIp;
+  b.server().benchRequest(HTTP_POST, "/save", "192.168.4.1",
+                          {{"ssid", "Home"}, {"password", "password"}});
+  b.beginNetwork("Home");
+  bool savedPlain = !WiFi.bssidHint && !WiFi.staticIp;
+  printf("{\"name\":\"provision/extras_follow_ssid\",\"other_plain\":%s,"
+         "\"owner_hinted\":%s,\"saved_plain\":%s,\"keys_dropped\":%s}\n",
+         otherPlain ? "true" : "false", ownerHinted ? "true" : "false",
+         savedPlain ? "true" : "false",
+         !benchNvs.values.count("bssid") && !benchNvs.values.count("ip")
+             ? "true"
+             : "false");
+
+  // COMMIT while boot owns the settings: journaled, applied after boot
+  b.nextUnit(4);
+  b.setBooting(true);
+  port.rx = unit;
+  port.rxPos = 0;
+  port.tx.clear();
+  b.serviceProvisioning();
+  bool journaled = replyStatus(port.tx).back() == WMProvision::OK &&
+                   benchNvs.values.count("txn") && !benchNvs.values.count("s0");
+  b.setBooting(false);
+  b.serviceProvisioning();
+  printf("{\"name\":\"provision/commit_during_boot\",\"journaled\":%s,"
+         "\"applied_after\":%s}\n",
+         journaled ? "true" : "false",
+         benchNvs.values["s0"] == "Factory-0" && !benchNvs.values.count("txn")
+             ? "true"
+             : "false");
+  fflush(stdout);
+
+  // --- Request arena high-water mark (sizing check for WM_ARENA_SIZE) ---
+  printf("{\"name\":\"arena/peak\",\"size_bytes\":%zu,\"capacity\":%d}\n",
+         b.arenaPeak(), (int)WM_ARENA_SIZE);
+
+  // --- generate_assets.py output ---
+  printf("{\"name\":\"assets/WM_HTML_INDEX\",\"size_bytes\":%zu}\n",
+         sizeof(WM_HTML_INDEX) - 1);
+  return 0;
+}
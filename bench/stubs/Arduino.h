@@ -0,0 +1,172 @@
+// Minimal host-side stand-ins for the Arduino-ESP32 core.
+#ifndef WM_BENCH_ARDUINO_H
+#define WM_BENCH_ARDUINO_H
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+
+#define PROGMEM
+#define RTC_DATA_ATTR
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define INPUT 0
+#define INPUT_PULLUP 2
+
+typedef uint8_t byte;
+
+inline unsigned long millis() {
+  using namespace std::chrono;
+  static const auto start = steady_clock::now();
+  return (unsigned long)duration_cast<milliseconds>(steady_clock::now() - start)
+             .count() +
+         benchClockOffsetMs;
+}
+inline unsigned long micros() {
+  using namespace std::chrono;
+  static const auto start = steady_clock::now();
+  return (unsigned long)duration_cast<microseconds>(steady_clock::now() - start)
+             .count() +
+         benchClockOffsetMs * 1000;
+}
+inline void delay(unsigned long ms) {
+  if (benchSkipDelays) {
+    benchClockOffsetMs += ms;
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+inline void yield() {}
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) { return HIGH; }
+
+class String {
+public:
+  String() {}
+  String(const char *s) : _s(s ? s : "") {}
+  String(const std::string &s) : _s(s) {}
+  String(char c) : _s(1, c) {}
+  String(int v) : _s(std::to_string(v)) {}
+  String(unsigned int v) : _s(std::to_string(v)) {}
+  String(long v) : _s(std::to_string(v)) {}
+  String(unsigned long v) : _s(std::to_string(v)) {}
+
+  const char *c_str() const { return _s.c_str(); }
+  unsigned int length() const { return _s.length(); }
+  bool reserve(unsigned int n) {
+    _s.reserve(n);
+    return true;
+  }
+  char operator[](unsigned int i) const { return _s[i]; }
+
+  String &operator+=(const String &o) {
+    _s += o._s;
+    return *this;
+  }
+  String &operator+=(const char *o) {
+    _s += o;
+    return *this;
+  }
+  String &operator+=(char c) {
+    _s += c;
+    return *this;
+  }
+  friend String operator+(const String &a, const String &b) {
+    return String(a._s + b._s);
+  }
+  friend String operator+(const String &a, const char *b) {
+    return String(a._s + b);
+  }
+  friend String operator+(const char *a, const String &b) {
+    return String(a + b._s);
+  }
+  bool operator==(const String &o) const { return _s == o._s; }
+  bool operator!=(const String &o) const { return _s != o._s; }
+  bool operator==(const char *o) const { return _s == o; }
+  bool operator!=(const char *o) const { return _s != o; }
+
+  bool endsWith(const String &suffix) const {
+    return _s.size() >= suffix._s.size() &&
+           _s.compare(_s.size() - suffix._s.size(), suffix._s.size(),
+                      suffix._s) == 0;
+  }
+  bool startsWith(const String &prefix) const {
+    return _s.compare(0, prefix._s.size(), prefix._s) == 0;
+  }
+  int indexOf(char c) const {
+    size_t p = _s.find(c);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  int indexOf(const char *c) const {
+    size_t p = _s.find(c);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+
+private:
+  std::string _s;
+};
+
+class Stream {
+public:
+  virtual ~Stream() {}
+  virtual size_t write(const uint8_t *buf, size_t n) = 0;
+  size_t write(uint8_t c) { return write(&c, 1); }
+  virtual int available() = 0;
+  virtual int read() = 0;
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  using Stream::write;
+  size_t write(const uint8_t *buf, size_t n) override {
+    return _quiet ? n : fwrite(buf, 1, n, stderr);
+  }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+  size_t println(const String &s) { return print(s) + print("\n"); }
+  size_t println() { return print("\n"); }
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return write((const uint8_t *)buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1);
+  }
+  void setQuiet(bool q) { _quiet = q; }
+
+private:
+  bool _quiet = true;
+};
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  void restart() { std::exit(0); }
+  uint32_t getFreeHeap() { return 200 * 1024; }
+  uint32_t getMaxAllocHeap() { return 110 * 1024; }
+};
+extern EspClass ESP;
+
+inline bool getLocalTime(struct tm *info, uint32_t = 5000) {
+  time_t now = ::time(nullptr);
+  localtime_r(&now, info);
+  return true;
+}
+inline void configTzTime(const char *, const char *, const char * = nullptr,
+                         const char * = nullptr) {}
+
+#endif
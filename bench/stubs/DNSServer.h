@@ -0,0 +1,14 @@
+// Host-side DNSServer stand-in.
+#ifndef WM_BENCH_DNSSERVER_H
+#define WM_BENCH_DNSSERVER_H
+
+#include <WiFi.h>
+
+class DNSServer {
+public:
+  bool start(uint16_t, const String &, const IPAddress &) { return true; }
+  void stop() {}
+  void processNextRequest() {}
+};
+
+#endif
@@ -0,0 +1,105 @@
+// Host-side Preferences stand-in: an in-memory NVS with write counters.
+// Like the real one, writes to a namespace opened read-only fail.
+#ifndef WM_BENCH_PREFERENCES_H
+#define WM_BENCH_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+
+struct BenchNvs {
+  std::map<std::string, std::string> values;
+  unsigned long writes = 0;
+  unsigned long erases = 0;
+  unsigned long opens = 0;
+};
+extern BenchNvs benchNvs;
+
+class Preferences {
+public:
+  bool begin(const char *, bool readOnly = false) {
+    _ro = readOnly;
+    benchNvs.opens++;
+    return true;
+  }
+  void end() {}
+  bool clear() {
+    if (_ro)
+      return false;
+    benchNvs.values.clear();
+    benchNvs.erases++;
+    return true;
+  }
+  bool isKey(const char *key) { return benchNvs.values.count(key) > 0; }
+  bool remove(const char *key) {
+    if (_ro)
+      return false;
+    benchNvs.erases++;
+    return benchNvs.values.erase(key) > 0;
+  }
+  String getString(const char *key, const String &def = String()) {
+    auto it = benchNvs.values.find(key);
+    return it == benchNvs.values.end() ? def : String(it->second);
+  }
+  size_t getString(const char *key, char *value, size_t maxLen) {
+    auto it = benchNvs.values.find(key);
+    if (it == benchNvs.values.end() || it->second.size() >= maxLen)
+      return 0;
+    memcpy(value, it->second.c_str(), it->second.size() + 1);
+    return it->second.size() + 1;
+  }
+  size_t putString(const char *key, const char *value) {
+    if (_ro)
+      return 0;
+    benchNvs.values[key] = value;
+    benchNvs.writes++;
+    return strlen(value);
+  }
+  size_t putString(const char *key, const String &value) {
+    return putString(key, value.c_str());
+  }
+  size_t getBytesLength(const char *key) {
+    auto it = benchNvs.values.find(key);
+    return it == benchNvs.values.end() ? 0 : it->second.size();
+  }
+  size_t getBytes(const char *key, void *buf, size_t maxLen) {
+    auto it = benchNvs.values.find(key);
+    if (it == benchNvs.values.end() || it->second.size() > maxLen)
+      return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+  size_t putBytes(const char *key, const void *value, size_t len) {
+    if (_ro)
+      return 0;
+    benchNvs.values[key] = std::string((const char *)value, len);
+    benchNvs.writes++;
+    return len;
+  }
+    bool getBool(const char *key, bool def = false) {
+    auto it = benchNvs.values.find(key);
+    return it == benchNvs.values.end() ? def : it->second == "1";
+  }
+  size_t putBool(const char *key, bool value) {
+    if (_ro)
+      return 0;
+    benchNvs.values[key] = value ? "1" : "0";
+    benchNvs.writes++;
+    return 1;
+  }
+  int32_t getInt(const char *key, int32_t def = 0) {
+    auto it = benchNvs.values.find(key);
+    return it == benchNvs.values.end() ? def : atoi(it->second.c_str());
+  }
+  size_t putInt(const char *key, int32_t value) {
+    if (_ro)
+      return 0;
+    benchNvs.values[key] = std::to_string(value);
+    benchNvs.writes++;
+    return 4;
+  }
+
+private:
+  bool _ro = false;
+};
+
+#endif
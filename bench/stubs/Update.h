@@ -0,0 +1,109 @@
+// Host-side Update stand-in: a simulated OTA partition in RAM. Like the
+// core it stages writes in one flash sector and erases/programs per sector.
+#ifndef WM_BENCH_UPDATE_H
+#define WM_BENCH_UPDATE_H
+
+#include <Arduino.h>
+#include <vector>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+#define SPI_FLASH_SEC_SIZE 4096
+
+class UpdateClass {
+public:
+  bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int = U_FLASH) {
+    abort();
+    _size = size == UPDATE_SIZE_UNKNOWN ? partitionSize : size;
+    if (_size > partitionSize) {
+      _error = "Bad Size Given";
+      return false;
+    }
+    _buffer = new uint8_t[SPI_FLASH_SEC_SIZE];
+    _running = true;
+    return true;
+  }
+  size_t write(uint8_t *data, size_t len) {
+    if (!_running)
+      return 0;
+    if (_progress + _buffered == 0 && len && data[0] != 0xE9) {
+      _error = "Magic byte is wrong, not 0xE9";
+      abort();
+      return 0;
+    }
+    if (_progress + _buffered + len > _size) {
+      _error = "No Space";
+      abort();
+      return 0;
+    }
+    size_t left = len;
+    while (left) {
+      size_t n = SPI_FLASH_SEC_SIZE - _buffered;
+      if (n > left)
+        n = left;
+      memcpy(_buffer + _buffered, data, n);
+      _buffered += n;
+      data += n;
+      left -= n;
+      if (_buffered == SPI_FLASH_SEC_SIZE)
+        flushSector();
+    }
+    return len;
+  }
+  bool end(bool evenIfRemaining = false) {
+    if (!_running)
+      return false;
+    if (_buffered && evenIfRemaining)
+      flushSector();
+    if (_buffered || (!evenIfRemaining && _progress != _size)) {
+      _error = "Premature End";
+      abort();
+      return false;
+    }
+    committedSize = _progress;
+    release();
+    committed++;
+    return true;
+  }
+  void abort() {
+    if (_running)
+      aborted++;
+    release();
+  }
+  bool isRunning() { return _running; }
+  bool hasError() { return _error != nullptr; }
+  const char *errorString() { return _error ? _error : "No Error"; }
+  size_t progress() { return _progress; }
+
+  // --- Bench controls ---
+  size_t partitionSize = 0x1E0000; // 1.875 MB app slot (default.csv)
+  std::vector<uint8_t> partition = std::vector<uint8_t>(0x1E0000);
+  size_t committedSize = 0; // Bytes of the last committed image
+  unsigned long sectorWrites = 0;
+  unsigned long committed = 0;
+  unsigned long aborted = 0;
+
+private:
+  void flushSector() {
+    memcpy(partition.data() + _progress, _buffer, _buffered);
+    _progress += _buffered;
+    _buffered = 0;
+    sectorWrites++;
+  }
+  void release() {
+    delete[] _buffer;
+    _buffer = nullptr;
+    _running = false;
+    _progress = _buffered = 0;
+  }
+
+  uint8_t *_buffer = nullptr;
+  size_t _buffered = 0;
+  size_t _progress = 0;
+  size_t _size = 0;
+  bool _running = false;
+  const char *_error = nullptr;
+};
+extern UpdateClass Update;
+
+#endif
@@ -0,0 +1,250 @@
+// Host-side WebServer stand-in. Handlers form a linked RequestHandler chain
+// matched linearly, like the Arduino-ESP32 core, so dispatch cost is
+// representative. Requests are injected with benchRequest().
+#ifndef WM_BENCH_WEBSERVER_H
+#define WM_BENCH_WEBSERVER_H
+
+#include <Arduino.h>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+typedef enum { HTTP_ANY, HTTP_GET, HTTP_POST, HTTP_PUT, HTTP_DELETE } HTTPMethod;
+
+#define HTTP_UPLOAD_BUFLEN 1436
+
+enum HTTPUploadStatus {
+  UPLOAD_FILE_START,
+  UPLOAD_FILE_WRITE,
+  UPLOAD_FILE_END,
+  UPLOAD_FILE_ABORTED
+};
+
+typedef struct {
+  HTTPUploadStatus status;
+  String filename;
+  String name;
+  String type;
+  size_t totalSize;
+  size_t currentSize;
+  uint8_t buf[HTTP_UPLOAD_BUFLEN];
+} HTTPUpload;
+
+class WebServer;
+
+// Same shape as the core's detail/RequestHandler.h (2.x signatures)
+class RequestHandler {
+public:
+  virtual ~RequestHandler() {}
+  virtual bool canHandle(HTTPMethod, String) { return false; }
+  virtual bool handle(WebServer &, HTTPMethod, String) { return false; }
+  virtual bool canUpload(String) { return false; }
+  virtual void upload(WebServer &, String, HTTPUpload &) {}
+  RequestHandler *next() { return _next; }
+  void next(RequestHandler *r) { _next = r; }
+
+private:
+  RequestHandler *_next = nullptr;
+};
+
+class WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  explicit WebServer(int port = 80) : _port(port) {}
+  ~WebServer() {
+    for (RequestHandler *h : _owned)
+      delete h;
+  }
+
+  void begin() { _listening = true; }
+  void stop() { _listening = false; }
+  void handleClient() { handleCalls++; }
+
+  void addHandler(RequestHandler *handler) {
+    if (!_last)
+      _first = _last = handler;
+    else {
+      _last->next(handler);
+      _last = handler;
+    }
+  }
+  void on(const String &uri, HTTPMethod method, THandlerFunction fn) {
+    RequestHandler *h = new FunctionHandler(uri, method, fn);
+    _owned.push_back(h);
+    addHandler(h);
+  }
+  void on(const String &uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+  void onNotFound(THandlerFunction fn) { _notFound = fn; }
+
+  String uri() { return _uri; }
+  HTTPMethod method() { return _method; }
+  String hostHeader() { return _host; }
+  // Like the core: replaces the list, only these headers are kept
+  void collectHeaders(const char *headerKeys[], const size_t headerKeysCount) {
+    _collect.assign(headerKeys, headerKeys + headerKeysCount);
+  }
+  String header(const String &name) {
+    for (auto &h : _reqHeaders)
+      if (h.first == name)
+        return h.second;
+    return String();
+  }
+  bool hasHeader(const String &name) {
+    for (auto &h : _reqHeaders)
+      if (h.first == name)
+        return true;
+    return false;
+  }
+  bool hasArg(const String &name) {
+    for (auto &a : _args)
+      if (a.first == name)
+        return true;
+    return false;
+  }
+  String arg(const String &name) {
+    for (auto &a : _args)
+      if (a.first == name)
+        return a.second;
+    return String();
+  }
+
+  bool authenticate(const char *user, const char *pass) {
+    return authUser == user && authPass == pass;
+  }
+  void requestAuthentication() { lastCode = 401; }
+
+  void sendHeader(const String &, const String &, bool = false) {}
+  void send(int code, const char *, const String &body) {
+    lastCode = code;
+    lastBodyLength = body.length();
+  }
+  void send(int code, const String &type, const String &body) {
+    send(code, type.c_str(), body);
+  }
+  void send(int code, const char *type, const char *body) {
+    send(code, type, String(body));
+  }
+  void setContentLength(size_t) {}
+  void sendContent(const char *content, size_t size) {
+    (void)content;
+    lastBodyLength += size;
+  }
+  void sendContent(const String &content) {
+    sendContent(content.c_str(), content.length());
+  }
+  void send_P(int code, const char *, const char *body) {
+    lastCode = code;
+    lastBodyLength = strlen(body);
+  }
+  void send_P(int code, const char *, const char *body, size_t length) {
+    (void)body;
+    lastCode = code;
+    lastBodyLength = length;
+  }
+
+  // --- Bench controls ---
+  int lastCode = 0;
+  size_t lastBodyLength = 0;
+  unsigned long handleCalls = 0;
+
+  bool benchRequest(HTTPMethod method, const String &uri,
+                    const String &host = "192.168.4.1",
+                    std::vector<std::pair<String, String>> args = {},
+                    std::vector<std::pair<String, String>> headers = {}) {
+    _method = method;
+    _uri = uri;
+    _host = host;
+    _args = std::move(args);
+    _reqHeaders.clear();
+    for (auto &h : headers)
+      if (h.first == "Authorization" ||
+          std::find(_collect.begin(), _collect.end(), h.first) != _collect.end())
+        _reqHeaders.push_back(h);
+    for (RequestHandler *h = _first; h; h = h->next()) {
+      if (h->canHandle(method, uri) && h->handle(*this, method, uri))
+        return true;
+    }
+    if (_notFound)
+      _notFound();
+    return false;
+  }
+  // Multipart file upload as the core's _parseForm delivers it: START,
+  // one WRITE per HTTP_UPLOAD_BUFLEN chunk, END, then the route handler
+  bool benchUpload(const String &uri, const uint8_t *data, size_t len,
+                   const String &filename,
+                   std::vector<std::pair<String, String>> args = {}) {
+    _method = HTTP_POST;
+    _uri = uri;
+    _args = std::move(args);
+    RequestHandler *h = _first;
+    while (h && !h->canHandle(HTTP_POST, uri))
+      h = h->next();
+    if (h && h->canUpload(uri)) {
+      _upload = new HTTPUpload(); // The core allocates one per request
+      _upload->status = UPLOAD_FILE_START;
+      _upload->filename = filename;
+      _upload->name = "firmware";
+      _upload->totalSize = _upload->currentSize = 0;
+      h->upload(*this, uri, *_upload);
+      _upload->status = UPLOAD_FILE_WRITE;
+      for (size_t at = 0; at < len; at += HTTP_UPLOAD_BUFLEN) {
+        size_t n = len - at < HTTP_UPLOAD_BUFLEN ? len - at : HTTP_UPLOAD_BUFLEN;
+        memcpy(_upload->buf, data + at, n);
+        _upload->currentSize = n;
+        _upload->totalSize += n;
+        h->upload(*this, uri, *_upload);
+      }
+      _upload->status = UPLOAD_FILE_END;
+      _upload->currentSize = 0;
+      h->upload(*this, uri, *_upload);
+      delete _upload;
+      _upload = nullptr;
+    }
+    if (h)
+      return h->handle(*this, HTTP_POST, uri);
+    if (_notFound)
+      _notFound();
+    return false;
+  }
+  bool listening() const { return _listening; }
+  String authUser, authPass; // Credentials authenticate() accepts
+
+private:
+  class FunctionHandler : public RequestHandler {
+  public:
+    FunctionHandler(const String &uri, HTTPMethod method, THandlerFunction fn)
+        : _uri(uri), _method(method), _fn(fn) {}
+    bool canHandle(HTTPMethod method, String uri) override {
+      return (_method == HTTP_ANY || _method == method) && _uri == uri;
+    }
+    bool handle(WebServer &, HTTPMethod, String) override {
+      _fn();
+      return true;
+    }
+
+  private:
+    String _uri;
+    HTTPMethod _method;
+    THandlerFunction _fn;
+  };
+
+  int _port;
+  bool _listening = false;
+  RequestHandler *_first = nullptr;
+  RequestHandler *_last = nullptr;
+  std::vector<RequestHandler *> _owned;
+  THandlerFunction _notFound;
+  String _uri;
+  HTTPMethod _method = HTTP_GET;
+  String _host;
+  std::vector<std::pair<String, String>> _args;
+  std::vector<std::pair<String, String>> _reqHeaders;
+  std::vector<String> _collect;
+  HTTPUpload *_upload = nullptr;
+};
+
+#endif
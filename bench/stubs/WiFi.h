@@ -0,0 +1,137 @@
+// Host-side WiFi stand-in: a scriptable radio with a fake scan table.
+#ifndef WM_BENCH_WIFI_H
+#define WM_BENCH_WIFI_H
+
+#include <Arduino.h>
+#include <vector>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+typedef enum { WIFI_AUTH_OPEN = 0, WIFI_AUTH_WPA2_PSK = 3 } wifi_auth_mode_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+class IPAddress {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0)
+      : _o{a, b, c, d} {}
+  IPAddress(const uint8_t *a) : _o{a[0], a[1], a[2], a[3]} {}
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _o[0], _o[1], _o[2], _o[3]);
+    return String(buf);
+  }
+  uint8_t operator[](int i) const { return _o[i]; }
+  operator String() const { return toString(); }
+
+private:
+  uint8_t _o[4];
+};
+
+
+struct BenchNetwork {
+  std::string ssid;
+  int32_t rssi;
+  uint8_t channel;
+  bool secure;
+};
+
+class WiFiClass {
+public:
+  // --- Bench controls ---
+  std::vector<BenchNetwork> networks;
+  wl_status_t nextStatus = WL_CONNECTED;
+  std::string acceptSsid; // Only this SSID connects (empty = any)
+  uint8_t mac[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+  bool staticIp = false;   // Last config() asked for a static address
+  bool bssidHint = false;  // Last begin() carried a BSSID
+  int scanOffChannelMs = 0; // accumulated simulated off-channel time
+  int scanCalls = 0;
+
+  // --- Arduino API subset ---
+  wl_status_t status() { return _status; }
+  wl_status_t begin(const char *ssid, const char *, int32_t = 0,
+                    const uint8_t *bssid = nullptr) {
+    _ssid = ssid;
+    bssidHint = bssid != nullptr;
+    _status = acceptSsid.empty() || acceptSsid == ssid ? nextStatus
+                                                       : WL_DISCONNECTED;
+    return _status;
+  }
+  bool disconnect(bool = false, bool = false) {
+    _status = WL_DISCONNECTED;
+    return true;
+  }
+  bool config(IPAddress ip, IPAddress, IPAddress, IPAddress = IPAddress()) {
+    staticIp = ip[0] != 0;
+    return true;
+  }
+  uint8_t *macAddress(uint8_t *out) {
+    memcpy(out, mac, 6);
+    return out;
+  }
+  bool mode(wifi_mode_t m) {
+    _mode = m;
+    return true;
+  }
+  wifi_mode_t getMode() { return _mode; }
+  bool setSleep(bool) { return true; }
+  bool softAP(const char *, const char * = nullptr, int = 1, int = 0,
+              int = 4) {
+    return true;
+  }
+  bool softAPConfig(IPAddress, IPAddress, IPAddress) { return true; }
+  bool softAPdisconnect(bool = false) { return true; }
+  IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+  IPAddress localIP() { return IPAddress(10, 0, 0, 2); }
+  uint8_t softAPgetStationNum() { return 1; }
+  String SSID() { return String(_ssid.c_str()); }
+  int8_t RSSI() { return -55; }
+  int32_t channel() { return 6; }
+
+  int16_t scanNetworks(bool async = false, bool = false, bool = false,
+                       uint32_t msPerChan = 300, uint8_t chan = 0) {
+    scanCalls++;
+    int channels = chan ? 1 : 13;
+    scanOffChannelMs += channels * (int)msPerChan;
+    _scanResult.clear();
+    for (auto &n : networks)
+      if (!chan || n.channel == chan)
+        _scanResult.push_back(n);
+    _scanDone = true;
+    return async ? WIFI_SCAN_RUNNING : (int16_t)_scanResult.size();
+  }
+  int16_t scanComplete() {
+    return _scanDone ? (int16_t)_scanResult.size() : WIFI_SCAN_FAILED;
+  }
+  void scanDelete() {
+    _scanResult.clear();
+    _scanDone = false;
+  }
+  String SSID(uint8_t i) { return String(_scanResult[i].ssid.c_str()); }
+  int32_t RSSI(uint8_t i) { return _scanResult[i].rssi; }
+  int32_t channel(uint8_t i) { return _scanResult[i].channel; }
+  wifi_auth_mode_t encryptionType(uint8_t i) {
+    return _scanResult[i].secure ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN;
+  }
+
+private:
+  wl_status_t _status = WL_DISCONNECTED;
+  wifi_mode_t _mode = WIFI_OFF;
+  std::string _ssid;
+  std::vector<BenchNetwork> _scanResult;
+  bool _scanDone = false;
+};
+extern WiFiClass WiFi;
+
+#endif
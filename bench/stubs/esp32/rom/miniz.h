@@ -0,0 +1,61 @@
+// Host-side stand-in for the ESP32 ROM inflater (tinfl), backed by zlib.
+// Same calling convention: raw deflate into a wrapping 32 KB window.
+#ifndef WM_BENCH_ROM_MINIZ_H
+#define WM_BENCH_ROM_MINIZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint32;
+
+#define TINFL_LZ_DICT_SIZE 32768
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+
+typedef enum {
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+typedef struct {
+  mz_uint32 m_state;
+  z_stream z;
+} tinfl_decompressor;
+
+#define tinfl_init(r)                                                          \
+  do {                                                                         \
+    (r)->m_state = 0;                                                          \
+  } while (0)
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor *r,
+                                     const mz_uint8 *in, size_t *inSize,
+                                     mz_uint8 *, mz_uint8 *out,
+                                     size_t *outSize, const mz_uint32) {
+  if (r->m_state == 0) {
+    r->z = z_stream();
+    if (inflateInit2(&r->z, -15) != Z_OK)
+      return TINFL_STATUS_FAILED;
+    r->m_state = 1;
+  }
+  r->z.next_in = (Bytef *)in;
+  r->z.avail_in = (uInt)*inSize;
+  r->z.next_out = out;
+  r->z.avail_out = (uInt)*outSize;
+  int ret = inflate(&r->z, Z_NO_FLUSH);
+  *inSize -= r->z.avail_in;
+  *outSize -= r->z.avail_out;
+  if (ret == Z_STREAM_END) {
+    inflateEnd(&r->z);
+    r->m_state = 2;
+    return TINFL_STATUS_DONE;
+  }
+  if (ret != Z_OK && ret != Z_BUF_ERROR)
+    return TINFL_STATUS_FAILED;
+  return r->z.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT
+                             : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+#endif
@@ -0,0 +1,44 @@
+// Host-side FreeRTOS subset backed by std::thread.
+#ifndef WM_BENCH_FREERTOS_H
+#define WM_BENCH_FREERTOS_H
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void (*TaskFunction_t)(void *);
+typedef std::thread *TaskHandle_t; // detached, never joined
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdPASS 1
+#define pdTRUE 1
+#define pdFALSE 0
+
+// Set by the bench so settle/cooldown delays do not dominate timings.
+// Skipped delays advance a virtual clock instead, so timeout loops built on
+// millis() still terminate.
+inline bool benchSkipDelays = false;
+inline unsigned long benchClockOffsetMs = 0;
+
+inline void vTaskDelay(TickType_t ticks) {
+  if (benchSkipDelays) {
+    benchClockOffsetMs += ticks ? ticks : 1;
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *, uint32_t,
+                              void *arg, UBaseType_t, TaskHandle_t *handle) {
+  std::thread *t = new std::thread(fn, arg);
+  t->detach();
+  if (handle)
+    *handle = t;
+  return pdPASS;
+}
+inline void vTaskDelete(TaskHandle_t) {}
+
+#endif
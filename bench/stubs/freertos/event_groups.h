@@ -0,0 +1,50 @@
+// Host-side FreeRTOS event groups backed by a mutex + condition variable.
+#ifndef WM_BENCH_EVENT_GROUPS_H
+#define WM_BENCH_EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+#include <condition_variable>
+#include <mutex>
+
+typedef uint32_t EventBits_t;
+struct EventGroupDef_t {
+  std::mutex m;
+  std::condition_variable cv;
+  EventBits_t bits = 0;
+};
+typedef EventGroupDef_t *EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() { return new EventGroupDef_t(); }
+inline void vEventGroupDelete(EventGroupHandle_t g) { delete g; }
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t b) {
+  std::lock_guard<std::mutex> lk(g->m);
+  g->bits |= b;
+  g->cv.notify_all();
+  return g->bits;
+}
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t b) {
+  std::lock_guard<std::mutex> lk(g->m);
+  EventBits_t prev = g->bits;
+  g->bits &= ~b;
+  return prev;
+}
+inline EventBits_t xEventGroupGetBits(EventGroupHandle_t g) {
+  std::lock_guard<std::mutex> lk(g->m);
+  return g->bits;
+}
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t b,
+                                       BaseType_t clear, BaseType_t all,
+                                       TickType_t ticks) {
+  std::unique_lock<std::mutex> lk(g->m);
+  auto ready = [&] { return all ? (g->bits & b) == b : (g->bits & b) != 0; };
+  if (ticks == portMAX_DELAY)
+    g->cv.wait(lk, ready);
+  else
+    g->cv.wait_for(lk, std::chrono::milliseconds(ticks), ready);
+  EventBits_t result = g->bits;
+  if (clear && ready())
+    g->bits &= ~b;
+  return result;
+}
+
+#endif
@@ -0,0 +1,10 @@
+// Storage for the host-side core singletons.
+#include <Preferences.h>
+#include <Update.h>
+#include <WiFi.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+BenchNvs benchNvs;
+UpdateClass Update;
@@ -15,11 +15,8 @@ document.addEventListener("DOMContentLoaded", () => {
 
   const wifiList = document.getElementById("wifi-list");
   const ssidInput = document.getElementById("ssid");
-  const foundNetworks = new Set();
-  const networkData = new Map(); // Store network data for sorting
-
-  // Clear placeholder when scan starts receiving data
-  let firstReceive = true;
+  const placeholder = document.getElementById("wifi-placeholder");
+  const rows = new Map(); // ssid -> row, patched in place between polls
 
   // Auto-stop polling when no new networks found
   let lastNetworkCount = 0;
@@ -27,18 +24,12 @@ document.addEventListener("DOMContentLoaded", () => {
   let pollInterval = null;
   let selectedSSID = null; // Track selected network
 
-  // --- UI Helpers ---
-  const scanningText = document.getElementById("scanning-text");
-
   // Refresh Button Logic
   document.getElementById("refresh-btn").onclick = (e) => {
     e.preventDefault();
     // Clear List
-    wifiList.innerHTML =
-      '<div style="text-align: center; padding: 1em; color: #888"><span id="scanning-text">Scanning...</span></div>';
-    foundNetworks.clear();
-    networkData.clear();
-    firstReceive = true;
+    wifiList.replaceChildren(placeholder);
+    rows.clear();
     lastNetworkCount = 0;
     noChangeCount = 0;
     selectedSSID = null;
@@ -54,114 +45,154 @@ document.addEventListener("DOMContentLoaded", () => {
 
   let scanDots = 0;
   setInterval(() => {
-    if (document.getElementById("scanning-text")) {
+    if (placeholder.isConnected) {
       scanDots = (scanDots + 1) % 4;
       document.getElementById("scanning-text").innerText =
         "Scanning" + ".".repeat(scanDots);
     }
   }, 500);
 
-  // Use polling to receive WiFi scan results (Zero-Dependency)
-  const fetchWifi = async () => {
-    try {
-      const response = await fetch("/list");
-      const networks = await response.json();
-
-      if (networks.length > 0 && firstReceive) {
-        // Remove scanning text
-        wifiList.innerHTML = "";
-        firstReceive = false;
-      }
-
-      // Store network data
-      networks.forEach((data) => {
-        if (!foundNetworks.has(data.ssid)) {
-          foundNetworks.add(data.ssid);
-          networkData.set(data.ssid, data);
-        }
+  // Compact scan format, asked for via Accept:
+  // [version=1][count] then per network [rssi:int8][flags:uint8][len][ssid]
+  const SCAN_TYPE = "application/x-wm-scan";
+  const utf8 = new TextDecoder();
+  const parseScan = (buf) => {
+    const view = new DataView(buf);
+    const list = [];
+    if (view.byteLength < 2 || view.getUint8(0) !== 1) return list;
+    let at = 2;
+    for (let i = 0; i < view.getUint8(1) && at + 3 <= view.byteLength; i++) {
+      const len = view.getUint8(at + 2);
+      list.push({
+        rssi: view.getInt8(at),
+        secure: (view.getUint8(at + 1) & 1) === 1, // bit 0: secured
+        ssid: utf8.decode(new Uint8Array(buf, at + 3, len)),
       });
+      at += 3 + len;
+    }
+    return list;
+  };
 
-      // Sort networks by signal strength (strongest first)
-      const sortedNetworks = Array.from(networkData.values()).sort(
-        (a, b) => b.rssi - a.rssi
-      );
+  // Signal level -> CSS class and bars
+  const signalLevel = (rssi) =>
+    rssi < -85 ? "weak" : rssi < -70 ? "fair" : "good";
+  const signalBars = { good: "▂▄▆█", fair: "▂▄▆", weak: "▂▄" };
 
-      // Rebuild list with sorted networks
-      if (sortedNetworks.length > 0 && firstReceive) {
-        wifiList.innerHTML = "";
-        firstReceive = false;
-      }
+  const selectRow = (ssid) => {
+    const prev = rows.get(selectedSSID);
+    if (prev) prev.el.classList.remove("selected");
+    selectedSSID = ssid;
+    rows.get(ssid).el.classList.add("selected");
 
-      // Clear and rebuild list
-      if (sortedNetworks.length > 0) {
-        wifiList.innerHTML = "";
-        sortedNetworks.forEach((data) => {
-          const item = document.createElement("div");
-          item.className = "wifi-item";
+    ssidInput.value = ssid;
+    document.getElementById("password").focus();
+  };
 
-          // Add selected class if this is the selected network
-          if (selectedSSID === data.ssid) {
-            item.classList.add("selected");
-          }
+  // Rows are built once per SSID; text goes through textContent
+  const createRow = (ssid) => {
+    const el = document.createElement("div");
+    el.className = "wifi-item fresh";
+    el.innerHTML =
+      '<div class="wifi-info"><div class="wifi-ssid"></div>' +
+      '<div class="wifi-security"></div></div>' +
+      '<div class="wifi-signal"><div class="wifi-bars"></div>' +
+      '<div class="wifi-dbm"></div></div>';
+    el.querySelector(".wifi-ssid").textContent = ssid;
+    // Slide in once, not again when the row is moved
+    el.addEventListener("animationend", () => el.classList.remove("fresh"));
+    el.onclick = () => selectRow(ssid);
+    return {
+      el,
+      rssi: null,
+      secure: null,
+      security: el.querySelector(".wifi-security"),
+      signal: el.querySelector(".wifi-signal"),
+      bars: el.querySelector(".wifi-bars"),
+      dbm: el.querySelector(".wifi-dbm"),
+    };
+  };
 
-          // Determine Signal Icon/Text
-          let signalColor = "#21ba45"; // Green
-          let signalBars = "▂▄▆█"; // Full signal
-          if (data.rssi < -70) {
-            signalColor = "#fbbd08"; // Yellow
-            signalBars = "▂▄▆";
-          }
-          if (data.rssi < -85) {
-            signalColor = "#db2828"; // Red
-            signalBars = "▂▄";
-          }
+  // Touch only the fields that changed since the last poll
+  const patchRow = (row, data) => {
+    if (row.rssi !== data.rssi) {
+      const level = signalLevel(data.rssi);
+      row.rssi = data.rssi;
+      row.signal.className = "wifi-signal " + level;
+      row.bars.textContent = signalBars[level];
+      row.dbm.textContent = data.rssi + " dBm";
+    }
+    if (row.secure !== data.secure) {
+      row.secure = data.secure;
+      row.security.textContent = data.secure ? "🔒 Secured" : "🔓 Open";
+    }
+  };
 
-          item.innerHTML = `
-                        <div style="flex-grow: 1;">
-                            <div style="font-weight: bold;">${data.ssid}</div>
-                            <div style="font-size: 0.8em; color: #999;">
-                              ${
-                                data.secure === "true"
-                                  ? "🔒 Secured"
-                                  : "🔓 Open"
-                              }
-                            </div>
-                        </div>
-                        <div style="text-align: right; color:${signalColor}; font-weight: bold;">
-                            <div style="font-size: 1.2em; letter-spacing: -2px;">${signalBars}</div>
-                            <div style="font-size: 0.75em; margin-top: 2px;">${
-                              data.rssi
-                            } dBm</div>
-                        </div>
-                    `;
-
-          item.onclick = () => {
-            // Update selected state
-            selectedSSID = data.ssid;
-            document
-              .querySelectorAll(".wifi-item")
-              .forEach((el) => el.classList.remove("selected"));
-            item.classList.add("selected");
-
-            ssidInput.value = data.ssid;
-            document.getElementById("password").focus();
-          };
-
-          wifiList.appendChild(item);
-        });
+  const render = (networks) => {
+    networks.forEach((data) => {
+      let row = rows.get(data.ssid);
+      if (!row) {
+        row = createRow(data.ssid);
+        rows.set(data.ssid, row);
       }
+      patchRow(row, data);
+    });
+    if (rows.size === 0) return;
+    if (placeholder.isConnected) placeholder.remove();
+
+    // Strongest first; only rows that are out of place get moved
+    const sorted = Array.from(rows.values()).sort((a, b) => b.rssi - a.rssi);
+    const items = wifiList.children;
+    sorted.forEach((row, i) => {
+      if (items[i] !== row.el) wifiList.insertBefore(row.el, items[i] || null);
+    });
+  };
+
+  // Use polling to receive WiFi scan results (Zero-Dependency)
+  const fetchWifi = async () => {
+    try {
+      const response = await fetch("/list", {
+        headers: { Accept: SCAN_TYPE },
+      });
+      const buf = await response.arrayBuffer();
+      // Older firmware (or a shared server without the Accept header
+      // collected) answers with JSON
+      const compact = (response.headers.get("Content-Type") || "").startsWith(
+        SCAN_TYPE
+      );
+      const networks = compact
+        ? parseScan(buf)
+        : JSON.parse(utf8.decode(buf)).map((n) => ({
+            ssid: n.ssid,
+            rssi: n.rssi,
+            secure: n.secure === true || n.secure === "true",
+          }));
+      // Non-zero while the device is still sweeping channels (partial list)
+      // No header (older firmware, stripped by a proxy): treat as finished
+      const channel = response.headers.get("X-Scan-Channel");
+      const scanning = channel !== null && channel !== "0";
+
+      const t0 = performance.now();
+      render(networks);
+      console.debug(
+        `[scan] ${networks.length} networks, ${buf.byteLength} B ` +
+          `${compact ? "compact" : "json"}, render ` +
+          `${(performance.now() - t0).toFixed(2)} ms`
+      );
 
       // Auto-stop polling when no new networks found for 3 consecutive times
-      const currentCount = foundNetworks.size;
-      if (currentCount === lastNetworkCount && currentCount > 0) {
-        noChangeCount++;
-        if (noChangeCount >= 3) {
-          console.log("No new networks found. Stopping scan.");
-          clearInterval(pollInterval);
-          pollInterval = null;
+      // (partial results while a sweep runs always keep polling)
+      const currentCount = rows.size;
+      if (!scanning) {
+        if (currentCount === lastNetworkCount && currentCount > 0) {
+          noChangeCount++;
+          if (noChangeCount >= 3) {
+            console.log("No new networks found. Stopping scan.");
+            clearInterval(pollInterval);
+            pollInterval = null;
+          }
+        } else {
+          noChangeCount = 0;
         }
-      } else {
-        noChangeCount = 0;
       }
       lastNetworkCount = currentCount;
     } catch (err) {
@@ -21,7 +21,14 @@ WebServer myServer(80);
 void setup() {
   Serial.begin(115200);
 
-  // 2. Setup your Dashboard Routes
+  // 2. Register your server with WiFiManager FIRST
+  // The portal and captive-probe routes are mounted on YOUR server instance
+  // (one socket on port 80). Registering before your own routes lets the
+  // portal take over "/" while it is active; once WiFi is configured the
+  // portal routes switch off and your dashboard answers instead.
+  wifiManager.useServer(&myServer); // <--- CRITICAL: Share the server instance
+
+  // 3. Setup your Dashboard Routes
   myServer.on("/", HTTP_GET, []() {
     String html = "<html><body style='font-family:sans-serif; "
                   "text-align:center; padding:50px;'>";
@@ -33,11 +40,7 @@ void setup() {
     myServer.send(200, "text/html", html);
   });
 
-  // 3. Register your server with WiFiManager
-  // This makes WiFiManager use YOUR server instance instead of starting its
-  // own.
   wifiManager
-      .useServer(&myServer) // <--- CRITICAL: Share the server instance
       .onConnected([]() {
         Serial.println("[APP] Dashboard is now online at http://" +
                        WiFi.localIP().toString());
@@ -56,4 +59,6 @@ void loop() {
   // - DNS Server
   // - Web Server requests (myServer.handleClient())
   // - WiFi Status & Reconnections
+  // Do not call myServer.handleClient() here as well: the task owns the
+  // server and WebServer must not be polled from two tasks.
 }
@@ -2,13 +2,17 @@
  * Example: OTA Integration (Middleware Mode)
  *
  * This example shows how to combine WiFiManager with:
- * 1. ArduinoOTA (For flashing over WiFi)
+ * 1. Built-in firmware update at POST /update (no ArduinoOTA needed)
  * 2. Standard WebServer Dashboard
  *
  * All networking runs in the background.
+ *
+ * Flash a new build from the PC (plain or gzip-compressed image):
+ *   gzip -k firmware.bin
+ *   curl -u admin:update-me -F "firmware=@firmware.bin.gz" \
+ *        "http://<device-ip>/update?sha256=$(sha256sum firmware.bin | cut -c1-64)"
  */
 
-#include <ArduinoOTA.h>
 #include <WebServer.h>
 #include <WiFiManager.h>
 
@@ -18,36 +22,24 @@ WebServer server(80);
 void setup() {
   Serial.begin(115200);
 
-  // 1. Setup WebServer Route
+  // 1. Share the server with WiFiManager before adding routes, so the
+  // setup portal can own "/" while it is active
+  wifiManager.useServer(&server);
+
+  // 2. Setup WebServer Route
   server.on("/", []() {
     server.send(200, "text/html",
                 "<h1>OTA Device is Running</h1><p>Time: " + wifiManager.now() +
                     "</p>");
   });
 
-  // 2. Setup ArduinoOTA
-  ArduinoOTA.setHostname("esp32-ota-device");
-  ArduinoOTA.onStart([]() {
-    String type =
-        (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
-    Serial.println("Start updating " + type);
-  });
-  ArduinoOTA.onEnd([]() { Serial.println("\nEnd"); });
-  ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-    Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
-  });
-  ArduinoOTA.onError(
-      [](ota_error_t error) { Serial.printf("Error[%u]: ", error); });
+  // 3. Firmware update on the same server (and in the setup portal).
+  // The device restarts into the new image once it is verified.
+  wifiManager.enableOTA("admin", "update-me");
 
-  // 3. Register with WiFiManager
-  // Note: ArduinoOTA.begin() should be called AFTER WiFi is connected.
-  // We use the onConnected callback for this.
+  // 4. Start WiFiManager
   wifiManager
-      .useServer(&server)
-      .onConnected([]() {
-        ArduinoOTA.begin();
-        Serial.println("[APP] OTA and WebServer ready!");
-      })
+      .onConnected([]() { Serial.println("[APP] OTA and WebServer ready!"); })
       .begin("OTA-Setup-Portal");
 
   // Handle server start
@@ -55,10 +47,7 @@ void setup() {
 }
 
 void loop() {
-  // WiFiManager handles server.handleClient() in background task.
-  // But ArduinoOTA.handle() still needs to be called.
-  // You can put it here or create a separate task.
-  ArduinoOTA.handle();
-
+  // WiFiManager handles server.handleClient() (and uploads) in its
+  // background task, nothing to poll here.
   delay(10);
 }
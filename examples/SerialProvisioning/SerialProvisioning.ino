@@ -0,0 +1,29 @@
+/**
+ * Example: Serial Provisioning (Factory Line)
+ *
+ * Units take their WiFi networks, static IP, AP name and NTP/timezone
+ * settings over the USB serial port in one transaction, no portal needed.
+ * Run the host tool once for the whole shift, then plug in one unit after
+ * another:
+ *   python3 tools/wm_provision.py /dev/ttyUSB0 \
+ *       --network Factory:secret --ap-name "Sensor-{mac}" --tz ICT-7 \
+ *       --test --units 100
+ */
+
+#include <Arduino.h>
+#include <WiFiManager.h>
+
+void setup() {
+  Serial.begin(115200);
+
+  // WiFiManager owns Serial reads from here on; before begin() so a unit
+  // with no saved networks can be provisioned straight away
+  wifiManager.enableSerialProvisioning(Serial)
+      .onConnected([]() { Serial.println("[APP] Connected"); })
+      .begin("ESP32-Setup-Portal");
+}
+
+void loop() {
+  // Provisioning is served from the WiFiManager background task.
+  delay(10);
+}
@@ -0,0 +1,99 @@
+#include "WM_Arena.h"
+#include <stdarg.h>
+
+static_assert(WM_ARENA_SIZE >= 256, "WM_ARENA_SIZE too small for /save");
+
+void WMArena::grow(size_t n) {
+  _used += n;
+  if (_used > _peak)
+    _peak = _used;
+}
+
+void *WMArena::alloc(size_t n) {
+  size_t start = (_used + 7) & ~(size_t)7;
+  if (start + n > sizeof(_buf))
+    return nullptr;
+  void *p = _buf + start;
+  grow(start + n - _used);
+  return p;
+}
+
+const char *WMArena::copy(const char *s, size_t maxLen) {
+  size_t n = 0;
+  while (n < maxLen && s[n])
+    n++;
+  char *p = (char *)alloc(n + 1);
+  if (!p)
+    return "";
+  memcpy(p, s, n);
+  p[n] = '\0';
+  return p;
+}
+
+const char *WMArena::printf(const char *fmt, ...) {
+  char *p = (char *)_buf + _used;
+  size_t room = sizeof(_buf) - _used;
+  va_list ap;
+  va_start(ap, fmt);
+  int n = room ? vsnprintf(p, room, fmt, ap) : -1;
+  va_end(ap);
+  if (n < 0 || (size_t)n >= room)
+    return "";
+  grow(n + 1);
+  return p;
+}
+
+WMArena::Text WMArena::text(size_t reserve) {
+  static char full[1] = "";
+  Text t;
+  if (_used >= sizeof(_buf)) {
+    t._data = full;
+    t._overflow = true;
+    return t;
+  }
+  t._data = (char *)_buf + _used;
+  t._cap = sizeof(_buf) - _used - 1;
+  t._reserve = reserve < t._cap ? reserve : t._cap;
+  t._cap -= t._reserve;
+  t._data[0] = '\0';
+  return t;
+}
+
+void WMArena::keep(const Text &t) {
+  if (t._data == (char *)_buf + _used)
+    grow(t._len + 1);
+}
+
+WMArena::Text &WMArena::Text::add(const char *s, size_t n) {
+  if (_len + n > _cap) {
+    _overflow = true;
+    return *this;
+  }
+  memcpy(_data + _len, s, n);
+  _len += n;
+  _data[_len] = '\0';
+  return *this;
+}
+
+WMArena::Text &WMArena::Text::add(const char *s) { return add(s, strlen(s)); }
+
+WMArena::Text &WMArena::Text::finish(const char *tail) {
+  _cap += _reserve;
+  _reserve = 0;
+  return add(tail);
+}
+
+WMArena::Text &WMArena::Text::addf(const char *fmt, ...) {
+  size_t room = _cap - _len + 1;
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(_data + _len, room, fmt, ap);
+  va_end(ap);
+  if (n < 0 || (size_t)n >= room) {
+    _data[_len] = '\0'; // Drop the partial write
+    _overflow = true;
+  } else {
+    _len += n;
+  }
+  return *this;
+}
@@ -0,0 +1,62 @@
+#ifndef WM_ARENA_H
+#define WM_ARENA_H
+
+#include "WM_Config.h"
+#include <Arduino.h>
+
+/**
+ * Per-request bump allocator for portal handlers.
+ *
+ * The buffer is part of the object (no heap), allocations only move a
+ * cursor forward and reset() releases everything at once. The portal router
+ * resets it after every response, so request scratch never outlives the
+ * request and never interleaves with long-lived heap blocks.
+ */
+class WMArena {
+public:
+  // Appends into the arena's free tail; keep it with WMArena::keep().
+  // Appends are all-or-nothing: one that does not fit is skipped and sets
+  // overflow(). finish() appends into the space held back by text(reserve),
+  // so a truncated document can still be closed.
+  class Text {
+  public:
+    Text &add(const char *s);
+    Text &add(const char *s, size_t n);
+    Text &addf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    Text &finish(const char *tail);
+    const char *c_str() const { return _data; }
+    size_t length() const { return _len; }
+    bool overflow() const { return _overflow; }
+
+  private:
+    friend class WMArena;
+    char *_data = nullptr;
+    size_t _len = 0;
+    size_t _cap = 0; // Excluding the terminator
+    size_t _reserve = 0;
+    bool _overflow = false;
+  };
+
+  void *alloc(size_t n); // nullptr when exhausted
+  // Copies at most maxLen chars; "" when exhausted
+  const char *copy(const char *s, size_t maxLen = (size_t)-1);
+  const char *printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+  // One open Text at a time, and no alloc() until it is kept or dropped
+  Text text(size_t reserve = 0);
+  void keep(const Text &t);
+
+  void reset() { _used = 0; }
+  size_t used() const { return _used; }
+  size_t peak() const { return _peak; } // High-water mark, for sizing
+  size_t capacity() const { return sizeof(_buf); }
+
+private:
+  void grow(size_t n);
+
+  alignas(8) uint8_t _buf[WM_ARENA_SIZE];
+  size_t _used = 0;
+  size_t _peak = 0;
+};
+
+#endif
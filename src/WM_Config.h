@@ -33,8 +33,47 @@
 #define WM_DEFAULT_AP_TIMEOUT 300000 // 5 Minutes (Power saving)
 #define WM_CONNECT_COOLDOWN_MS 1000  // Delay between connection attempts (ms)
 #define WM_CONNECT_TIMEOUT_MS 15000  // Max time to wait for connection (ms)
+#define WM_MAX_NETWORKS 3            // Saved networks (NVS slots s0..s2)
 #define WM_MAX_BOOT_RETRIES 3        // Number of full cycles to try before AP
 #define WM_BOOT_RETRY_DELAY_MS 5000  // Rest time between full cycles (ms)
+#define WM_WAIT_FOREVER 0xFFFFFFFFUL // waitConnected() without timeout
+
+// --- Incremental Scan Settings ---
+#define WM_SCAN_CHANNELS 13       // Channels swept per scan (1..N)
+#define WM_SCAN_DWELL_MS 120      // Active dwell per channel slice (ms)
+#define WM_SCAN_SLICE_GAP_MS 250  // SoftAP service time between slices (ms)
+#define WM_SCAN_MIN_AGE_MS 10000  // /list re-sweeps only older results (ms)
+#ifndef WM_SCAN_MAX_RESULTS
+#define WM_SCAN_MAX_RESULTS 32 // Merged networks kept for /list
+#endif
+
+// --- Firmware Update (enableOTA) ---
+#define WM_OTA_GZIP 1 // Accept .bin.gz uploads (~43 KB heap while inflating)
+
+// --- Serial Provisioning (enableSerialProvisioning) ---
+#define WM_PROV_FRAME_TIMEOUT_MS 500 // Drop a partial frame after this gap
+
+// --- Portal Request Arena (WM_Arena.h) ---
+// Scratch for one portal request, reset after each response. Sized for a
+// full /list reply: ~71 bytes per entry with a 32-char SSID.
+#ifndef WM_ARENA_SIZE
+#define WM_ARENA_SIZE (256 + WM_SCAN_MAX_RESULTS * 80)
+#endif
+
+// --- Link History (enableLinkHistory) ---
+#define WM_LINK_SAMPLE_MS 1000 // Default sampling period (ms)
+#define WM_LINK_TIER0_SECS 1   // 1 s buckets ...
+#define WM_LINK_TIER0_LEN 300  // ... for 5 minutes
+#define WM_LINK_TIER1_SECS 60  // 1 min buckets ...
+#define WM_LINK_TIER1_LEN 1440 // ... for 24 hours
+#define WM_LINK_TIER2_SECS 900 // 15 min buckets ...
+#define WM_LINK_TIER2_LEN 672  // ... for 7 days
+
+// --- Deferred Logger (WM_Log.h) ---
+#define WM_LOG_SLOTS 32          // Ring records (power of two)
+#define WM_LOG_PAYLOAD 48        // Encoded argument bytes per record
+#define WM_LOG_TASK_PRIORITY 1   // Drain task, same as loop()
+#define WM_LOG_DRAIN_IDLE_MS 20  // Drain task sleep when the ring is empty
 
 // --- RTC & NTP Settings ---
 #define WM_NTP_SERVER "pool.ntp.org"
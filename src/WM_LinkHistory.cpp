@@ -0,0 +1,101 @@
+#include "WM_LinkHistory.h"
+#include <stdlib.h>
+
+WMLinkHistory::~WMLinkHistory() { free(_storage); }
+
+bool WMLinkHistory::begin() {
+  if (_storage)
+    return true;
+
+  const uint16_t lens[TIERS] = {WM_LINK_TIER0_LEN, WM_LINK_TIER1_LEN,
+                                WM_LINK_TIER2_LEN};
+  const uint32_t secs[TIERS] = {WM_LINK_TIER0_SECS, WM_LINK_TIER1_SECS,
+                                WM_LINK_TIER2_SECS};
+  size_t total = 0;
+  for (int i = 0; i < TIERS; i++)
+    total += lens[i];
+
+  // One block for all tiers, so a long-running device never re-allocates
+  _storage = (WMLinkBucket *)calloc(total, sizeof(WMLinkBucket));
+  if (!_storage)
+    return false;
+
+  WMLinkBucket *next = _storage;
+  for (int i = 0; i < TIERS; i++) {
+    _tiers[i]._ring = next;
+    _tiers[i]._capacity = lens[i];
+    _tiers[i]._resolution = secs[i];
+    next += lens[i];
+  }
+  return true;
+}
+
+size_t WMLinkHistory::memoryUsage() const {
+  size_t total = 0;
+  for (int i = 0; i < TIERS; i++)
+    total += _tiers[i]._capacity * sizeof(WMLinkBucket);
+  return total;
+}
+
+void WMLinkHistory::add(uint32_t nowSec, const WMLinkSample &sample) {
+  if (!_storage)
+    return;
+
+  // Counters arrive cumulative; buckets hold the increase since last sample
+  uint32_t reconnects = _hasLast ? sample.reconnects - _last.reconnects : 0;
+  uint32_t txRetries = _hasLast ? sample.txRetries - _last.txRetries : 0;
+  _last = sample;
+  _hasLast = true;
+
+  for (int i = 0; i < TIERS; i++)
+    _tiers[i].fold(nowSec, sample, reconnects, txRetries);
+}
+
+void WMLinkHistory::Tier::fold(uint32_t now, const WMLinkSample &s,
+                               uint32_t reconnects, uint32_t txRetries) {
+  if (_acc.samples > 0 && now - _acc.start >= _resolution)
+    close();
+
+  if (_acc.samples == 0) {
+    _acc.start = now - now % _resolution;
+    _acc.rssiMin = s.rssi;
+    _acc.rssiMax = s.rssi;
+    _acc.heapMin = s.freeHeap;
+    _acc.heapMax = s.freeHeap;
+  }
+
+  _acc.samples++;
+  if (s.rssi < _acc.rssiMin)
+    _acc.rssiMin = s.rssi;
+  if (s.rssi > _acc.rssiMax)
+    _acc.rssiMax = s.rssi;
+  _acc.rssiSum += s.rssi;
+  _acc.channel = s.channel;
+  _acc.reconnects += reconnects;
+  _acc.txRetries += txRetries;
+  if (s.freeHeap < _acc.heapMin)
+    _acc.heapMin = s.freeHeap;
+  if (s.freeHeap > _acc.heapMax)
+    _acc.heapMax = s.freeHeap;
+  _acc.heapSum += s.freeHeap;
+}
+
+void WMLinkHistory::Tier::close() {
+  WMLinkBucket &b = _ring[_head];
+  b.time = _acc.start;
+  b.samples = _acc.samples > 0xFFFF ? 0xFFFF : _acc.samples;
+  b.rssiMin = _acc.rssiMin;
+  b.rssiAvg = (int8_t)(_acc.rssiSum / (int32_t)_acc.samples);
+  b.rssiMax = _acc.rssiMax;
+  b.channel = _acc.channel;
+  b.reconnects = _acc.reconnects > 0xFFFF ? 0xFFFF : _acc.reconnects;
+  b.txRetries = _acc.txRetries > 0xFFFF ? 0xFFFF : _acc.txRetries;
+  b.heapMinKB = _acc.heapMin / 1024;
+  b.heapAvgKB = (uint16_t)(_acc.heapSum / _acc.samples / 1024);
+  b.heapMaxKB = _acc.heapMax / 1024;
+
+  _head = (_head + 1) % _capacity;
+  if (_count < _capacity)
+    _count++;
+  _acc = {};
+}
@@ -0,0 +1,122 @@
+#ifndef WM_LINK_HISTORY_H
+#define WM_LINK_HISTORY_H
+
+#include "WM_Config.h"
+#include <Arduino.h>
+
+/**
+ * Multi-resolution link-quality history.
+ *
+ * Every sample is folded into one accumulator per tier; when a tier's
+ * bucket period ends the accumulator is closed into that tier's ring.
+ * All storage is allocated once by begin(), add() never allocates.
+ */
+
+// One raw reading. Counters are cumulative, the history stores deltas.
+struct WMLinkSample {
+  int8_t rssi; // dBm, -127 while disconnected
+  uint8_t channel;
+  uint32_t reconnects;
+  uint32_t txRetries;
+  uint32_t freeHeap; // bytes
+};
+
+// One closed bucket (20 bytes)
+struct WMLinkBucket {
+  uint32_t time; // Seconds since boot at bucket start
+  uint16_t samples; // Saturates at 65535
+  int8_t rssiMin;
+  int8_t rssiAvg;
+  int8_t rssiMax;
+  uint8_t channel; // Last channel seen
+  uint16_t reconnects; // Link drops during the bucket
+  uint16_t txRetries;  // Retransmissions during the bucket
+  uint16_t heapMinKB;
+  uint16_t heapAvgKB;
+  uint16_t heapMaxKB;
+};
+
+class WMLinkHistory {
+public:
+  static const int TIERS = 3;
+
+  class Tier {
+  public:
+    class const_iterator {
+    public:
+      const_iterator(const Tier *tier, uint16_t pos) : _tier(tier), _pos(pos) {}
+      const WMLinkBucket &operator*() const { return _tier->at(_pos); }
+      const WMLinkBucket *operator->() const { return &_tier->at(_pos); }
+      const_iterator &operator++() {
+        ++_pos;
+        return *this;
+      }
+      bool operator!=(const const_iterator &o) const { return _pos != o._pos; }
+      bool operator==(const const_iterator &o) const { return _pos == o._pos; }
+
+    private:
+      const Tier *_tier;
+      uint16_t _pos;
+    };
+
+    // Oldest to newest
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, _count); }
+    const WMLinkBucket &at(uint16_t i) const {
+      return _ring[(_head + _capacity - _count + i) % _capacity];
+    }
+    uint16_t size() const { return _count; }
+    uint16_t capacity() const { return _capacity; }
+    uint32_t resolution() const { return _resolution; }
+
+  private:
+    friend class WMLinkHistory;
+
+    struct Accumulator {
+      uint32_t start;
+      uint32_t samples; // 900 s at a 1 ms period is past 16 bits
+      int8_t rssiMin;
+      int8_t rssiMax;
+      int32_t rssiSum;
+      uint8_t channel;
+      uint32_t reconnects;
+      uint32_t txRetries;
+      uint32_t heapMin;
+      uint32_t heapMax;
+      uint64_t heapSum;
+    };
+
+    void fold(uint32_t now, const WMLinkSample &s, uint32_t reconnects,
+              uint32_t txRetries);
+    void close();
+
+    WMLinkBucket *_ring = nullptr;
+    uint16_t _capacity = 0;
+    uint16_t _head = 0; // Next slot to write
+    uint16_t _count = 0;
+    uint32_t _resolution = 1;
+    Accumulator _acc = {};
+  };
+
+  WMLinkHistory() {}
+  ~WMLinkHistory();
+
+  // Allocates every tier ring once; false if out of memory
+  bool begin();
+  bool active() const { return _storage != nullptr; }
+
+  void add(uint32_t nowSec, const WMLinkSample &sample);
+  const Tier &tier(int i) const { return _tiers[i]; }
+  size_t memoryUsage() const;
+
+private:
+  WMLinkHistory(const WMLinkHistory &) = delete;
+  WMLinkHistory &operator=(const WMLinkHistory &) = delete;
+
+  Tier _tiers[TIERS];
+  WMLinkBucket *_storage = nullptr;
+  WMLinkSample _last = {};
+  bool _hasLast = false;
+};
+
+#endif // WM_LINK_HISTORY_H
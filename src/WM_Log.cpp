@@ -0,0 +1,219 @@
+#include "WM_Log.h"
+
+WMLog::Slot WMLog::_ring[WM_LOG_SLOTS];
+std::atomic<uint32_t> WMLog::_head(0);
+std::atomic<uint32_t> WMLog::_tail(0);
+std::atomic<unsigned long> WMLog::_dropped(0);
+TaskHandle_t WMLog::_task = nullptr;
+
+static_assert((WM_LOG_SLOTS & (WM_LOG_SLOTS - 1)) == 0,
+              "WM_LOG_SLOTS must be a power of two");
+
+// Bounded MPMC queue scheme (Vyukov) with each slot's sequence stored
+// relative to its index, so the zero-initialised ring is already valid and
+// producers may log before begin() or during static construction:
+//   seq == lap       slot free for position lap + index
+//   seq == lap + 1   record published, waiting for a reader
+static const uint32_t LAP_MASK = ~(uint32_t)(WM_LOG_SLOTS - 1);
+
+void WMLog::begin() {
+  if (_task)
+    return;
+  xTaskCreate(drainTask, "wm_log", 3072, nullptr, WM_LOG_TASK_PRIORITY,
+              &_task);
+}
+
+void WMLog::commit(const Record &r) {
+  // Claim a slot: any number of producers, no locks, never waits
+  uint32_t pos = _head.load(std::memory_order_relaxed);
+  Slot *slot;
+  while (true) {
+    slot = &_ring[pos & (WM_LOG_SLOTS - 1)];
+    uint32_t seq = slot->seq.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - (pos & LAP_MASK));
+    if (diff == 0) {
+      if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      _dropped.fetch_add(1, std::memory_order_relaxed); // Ring full
+      return;
+    } else {
+      pos = _head.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->rec = r;
+  slot->seq.store((pos & LAP_MASK) + 1, std::memory_order_release);
+}
+
+bool WMLog::pop(Record &r) {
+  // Claim the tail the same way producers claim the head: flush() may run
+  // on the drain task and on a restarting task at the same time
+  uint32_t pos = _tail.load(std::memory_order_relaxed);
+  Slot *slot;
+  while (true) {
+    slot = &_ring[pos & (WM_LOG_SLOTS - 1)];
+    uint32_t seq = slot->seq.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - ((pos & LAP_MASK) + 1));
+    if (diff == 0) {
+      if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false; // Empty, or the producer is still copying
+    } else {
+      pos = _tail.load(std::memory_order_relaxed); // Another reader took it
+    }
+  }
+
+  r = slot->rec;
+  slot->seq.store((pos & LAP_MASK) + WM_LOG_SLOTS, std::memory_order_release);
+  return true;
+}
+
+size_t WMLog::format(const Record &r, char *out, size_t size) {
+  size_t len = 0;
+  auto append = [&](int n) {
+    if (n > 0)
+      len += (size_t)n < size - len ? (size_t)n : size - len - 1;
+  };
+
+  if (r.flags & FLAG_VERBATIM) {
+    append(snprintf(out, size, "%s", r.fmt));
+  } else {
+    const char *f = r.fmt;
+    uint8_t at = 0;
+    while (*f && len < size - 1) {
+      if (*f != '%') {
+        out[len++] = *f++;
+        continue;
+      }
+      if (f[1] == '%') {
+        out[len++] = '%';
+        f += 2;
+        continue;
+      }
+
+      // Copy one conversion spec ("%-08lu") and find its conversion char
+      char spec[16];
+      size_t n = 0;
+      bool isLong = false, isLongLong = false;
+      spec[n++] = *f++;
+      while (*f && !strchr("diouxXcsfFeEgGp", *f) && n < sizeof(spec) - 2) {
+        if (*f == 'l') {
+          isLongLong = isLong;
+          isLong = true;
+        }
+        spec[n++] = *f++;
+      }
+      char conv = *f ? *f++ : 's';
+      spec[n++] = conv;
+      spec[n] = '\0';
+
+      if (at >= r.len) {
+        append(snprintf(out + len, size - len, "<?>"));
+        continue;
+      }
+      uint8_t tag = r.payload[at++];
+      const uint8_t *data = r.payload + at;
+      char *dst = out + len;
+      size_t room = size - len;
+
+      // A spec/argument mismatch must not reach snprintf (e.g. %s on an int)
+      uint8_t want = conv == 's'                 ? ARG_STR
+                     : conv == 'p'               ? ARG_PTR
+                     : strchr("fFeEgG", conv)    ? ARG_DBL
+                                                 : 0;
+      bool isInt = tag == ARG_I32 || tag == ARG_U32 || tag == ARG_I64;
+      if (want ? tag != want : !isInt) {
+        at += tag == ARG_STR                    ? 1 + data[0]
+              : tag == ARG_I32 || tag == ARG_U32 ? 4
+              : tag == ARG_PTR                   ? sizeof(void *)
+                                                 : 8;
+        append(snprintf(dst, room, "<?>"));
+        continue;
+      }
+
+      if (tag == ARG_STR) {
+        uint8_t sl = data[0];
+        char tmp[WM_LOG_PAYLOAD];
+        memcpy(tmp, data + 1, sl);
+        tmp[sl] = '\0';
+        at += 1 + sl;
+        append(snprintf(dst, room, spec, tmp));
+      } else if (tag == ARG_DBL) {
+        double v;
+        memcpy(&v, data, sizeof(v));
+        at += sizeof(v);
+        append(snprintf(dst, room, spec, v));
+      } else if (tag == ARG_PTR) {
+        const void *v;
+        memcpy(&v, data, sizeof(v));
+        at += sizeof(v);
+        append(snprintf(dst, room, spec, v));
+      } else {
+        // Widen to 64-bit, then narrow to what the spec expects
+        long long v;
+        if (tag == ARG_I64) {
+          memcpy(&v, data, sizeof(v));
+          at += sizeof(v);
+        } else if (tag == ARG_I32) {
+          int32_t n;
+          memcpy(&n, data, sizeof(n));
+          at += sizeof(n);
+          v = n;
+        } else {
+          uint32_t n;
+          memcpy(&n, data, sizeof(n));
+          at += sizeof(n);
+          v = n;
+        }
+        bool isSigned = conv == 'd' || conv == 'i';
+        if (conv == 'c')
+          append(snprintf(dst, room, spec, (int)v));
+        else if (isLongLong)
+          append(isSigned ? snprintf(dst, room, spec, v)
+                          : snprintf(dst, room, spec, (unsigned long long)v));
+        else if (isLong)
+          append(isSigned ? snprintf(dst, room, spec, (long)v)
+                          : snprintf(dst, room, spec, (unsigned long)v));
+        else
+          append(isSigned ? snprintf(dst, room, spec, (int)v)
+                          : snprintf(dst, room, spec, (unsigned int)v));
+      }
+    }
+    out[len] = '\0';
+  }
+
+  if ((r.flags & FLAG_NEWLINE) && len < size - 1) {
+    out[len++] = '\n';
+    out[len] = '\0';
+  }
+  return len;
+}
+
+void WMLog::flush() {
+  static std::atomic<unsigned long> reportedDrops(0);
+  char line[160];
+  Record r;
+  while (pop(r)) {
+    size_t n = format(r, line, sizeof(line));
+    Serial.write((const uint8_t *)line, n);
+  }
+
+  // Only the reader that moves the mark forward reports the difference
+  unsigned long drops = _dropped.load();
+  unsigned long seen = reportedDrops.load();
+  while (drops > seen) {
+    if (reportedDrops.compare_exchange_weak(seen, drops)) {
+      Serial.printf("[WMLog] %lu messages dropped\n", drops - seen);
+      break;
+    }
+  }
+}
+
+void WMLog::drainTask(void *) {
+  while (true) {
+    flush();
+    vTaskDelay(pdMS_TO_TICKS(WM_LOG_DRAIN_IDLE_MS));
+  }
+}
@@ -0,0 +1,188 @@
+#ifndef WM_LOG_H
+#define WM_LOG_H
+
+#include "WM_Config.h"
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * Deferred logger.
+ *
+ * WM_LOG/WM_LOGF store a binary record (format pointer + encoded args) in a
+ * lock-free ring; a low-priority task formats and writes them to Serial.
+ * The caller never waits on the UART. When the ring is full the record is
+ * dropped and counted instead of blocking.
+ *
+ * Formats must be string literals (only the pointer is stored), and so must
+ * the WM_LOG() text. String arguments and WMLog::line() text are copied into
+ * the record, truncated to fit.
+ */
+
+#define WM_LOG_LEVEL_NONE 0
+#define WM_LOG_LEVEL_ERROR 1
+#define WM_LOG_LEVEL_INFO 2
+#define WM_LOG_LEVEL_DEBUG 3
+
+// Compile-time filter: DEBUG_MODE keeps everything, field builds can pass
+// -DWM_LOG_LEVEL=1/2 to compile out the chattier levels entirely.
+#ifndef WM_LOG_LEVEL
+#ifdef DEBUG_MODE
+#define WM_LOG_LEVEL WM_LOG_LEVEL_DEBUG
+#else
+#define WM_LOG_LEVEL WM_LOG_LEVEL_NONE
+#endif
+#endif
+
+class WMLog {
+public:
+  // Starts the drain task (safe to call more than once)
+  static void begin();
+  // Formats every pending record on the calling task, e.g. before restart.
+  // Safe from any task, also while the drain task is running.
+  static void flush();
+  static unsigned long dropped() { return _dropped.load(); }
+
+  // Copies the text into the record (truncated to fit): safe for stack
+  // buffers and Strings that go away before the drain task runs.
+  static void line(uint8_t level, const char *text) {
+    Record r;
+    open(r, level, "%s", FLAG_NEWLINE);
+    put(r, text);
+    commit(r);
+  }
+  static void line(uint8_t level, const String &text) {
+    line(level, text.c_str());
+  }
+  // Stores only the pointer. String literals only, which is what WM_LOG()
+  // enforces by pasting "" in front of its argument.
+  static void literal(uint8_t level, const char *text) {
+    Record r;
+    open(r, level, text, FLAG_VERBATIM | FLAG_NEWLINE);
+    commit(r);
+  }
+
+  template <typename... Args>
+  static void printf(uint8_t level, const char *fmt, Args... args) {
+    Record r;
+    open(r, level, fmt, 0);
+    putAll(r, args...);
+    commit(r);
+  }
+
+  // Exposed for the drain task trampoline
+  static void drainTask(void *);
+
+private:
+  enum : uint8_t { FLAG_VERBATIM = 1, FLAG_NEWLINE = 2 };
+  // Integers take 4 payload bytes unless they need 8
+  enum : uint8_t { ARG_I32 = 'i', ARG_U32 = 'u', ARG_I64 = 'I', ARG_DBL = 'f',
+                   ARG_STR = 's', ARG_PTR = 'p' };
+
+  struct Record {
+    const char *fmt;
+    uint32_t ms;
+    uint8_t level;
+    uint8_t flags;
+    uint8_t len; // Payload bytes used
+    uint8_t payload[WM_LOG_PAYLOAD];
+  };
+
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    Record rec;
+  };
+
+  static void open(Record &r, uint8_t level, const char *fmt, uint8_t flags) {
+    r.fmt = fmt;
+    r.ms = millis();
+    r.level = level;
+    r.flags = flags;
+    r.len = 0;
+  }
+  static void commit(const Record &r);
+  static bool pop(Record &r);
+  static size_t format(const Record &r, char *out, size_t size);
+
+  static void putRaw(Record &r, uint8_t tag, const void *data, uint8_t n) {
+    if (r.len + 1 + n > WM_LOG_PAYLOAD)
+      return; // Out of room: the formatter prints a placeholder
+    r.payload[r.len++] = tag;
+    memcpy(r.payload + r.len, data, n);
+    r.len += n;
+  }
+  static void put(Record &r, long long v) {
+    int32_t n = (int32_t)v;
+    if (n == v)
+      putRaw(r, ARG_I32, &n, sizeof(n));
+    else
+      putRaw(r, ARG_I64, &v, sizeof(v));
+  }
+  static void put(Record &r, unsigned long long v) {
+    uint32_t n = (uint32_t)v;
+    if (n == v)
+      putRaw(r, ARG_U32, &n, sizeof(n));
+    else
+      putRaw(r, ARG_I64, &v, sizeof(v));
+  }
+  static void put(Record &r, int v) { put(r, (long long)v); }
+  static void put(Record &r, long v) { put(r, (long long)v); }
+  static void put(Record &r, unsigned int v) { put(r, (unsigned long long)v); }
+  static void put(Record &r, unsigned long v) {
+    put(r, (unsigned long long)v);
+  }
+  static void put(Record &r, double v) { putRaw(r, ARG_DBL, &v, sizeof(v)); }
+  static void put(Record &r, const void *v) {
+    putRaw(r, ARG_PTR, &v, sizeof(v));
+  }
+  static void put(Record &r, const char *s) {
+    if (!s)
+      s = "(null)";
+    size_t room = WM_LOG_PAYLOAD - r.len;
+    if (room < 3)
+      return;
+    size_t n = 0; // Truncate to what is left after tag + length byte
+    while (n < room - 2 && s[n])
+      n++;
+    r.payload[r.len++] = ARG_STR;
+    r.payload[r.len++] = (uint8_t)n;
+    memcpy(r.payload + r.len, s, n);
+    r.len += n;
+  }
+  static void put(Record &r, char *s) { put(r, (const char *)s); }
+
+  static void putAll(Record &) {}
+  template <typename T, typename... Rest>
+  static void putAll(Record &r, T first, Rest... rest) {
+    put(r, first);
+    putAll(r, rest...);
+  }
+
+  static Slot _ring[WM_LOG_SLOTS];
+  static std::atomic<uint32_t> _head;
+  static std::atomic<uint32_t> _tail;
+  static std::atomic<unsigned long> _dropped;
+  static TaskHandle_t _task;
+};
+
+// --- Logging Macros ---
+#if WM_LOG_LEVEL >= WM_LOG_LEVEL_ERROR
+#define WM_LOGE(x, ...) WMLog::printf(WM_LOG_LEVEL_ERROR, x, ##__VA_ARGS__)
+#else
+#define WM_LOGE(x, ...)
+#endif
+
+#if WM_LOG_LEVEL >= WM_LOG_LEVEL_INFO
+#define WM_LOG(x) WMLog::literal(WM_LOG_LEVEL_INFO, "" x)
+#define WM_LOGF(x, ...) WMLog::printf(WM_LOG_LEVEL_INFO, x, ##__VA_ARGS__)
+#else
+#define WM_LOG(x)
+#define WM_LOGF(x, ...)
+#endif
+
+#if WM_LOG_LEVEL >= WM_LOG_LEVEL_DEBUG
+#define WM_LOGD(x, ...) WMLog::printf(WM_LOG_LEVEL_DEBUG, x, ##__VA_ARGS__)
+#else
+#define WM_LOGD(x, ...)
+#endif
+
+#endif // WM_LOG_H
@@ -0,0 +1,270 @@
+#include "WM_OTA.h"
+#include <Update.h>
+#include <stdlib.h>
+
+// The ESP32 ROM carries miniz's inflater, so gzip costs no flash
+#if WM_OTA_GZIP && defined(__has_include)
+#if __has_include(<esp32/rom/miniz.h>)
+#include <esp32/rom/miniz.h>
+#define WM_OTA_HAS_GZIP 1
+#endif
+#endif
+
+// gzip header flags and the order their fields follow the fixed 10 bytes
+enum : uint8_t {
+  GZ_FHCRC = 0x02,
+  GZ_FEXTRA = 0x04,
+  GZ_FNAME = 0x08,
+  GZ_FCOMMENT = 0x10
+};
+enum : uint8_t {
+  GZ_FIXED,
+  GZ_EXTRA_LEN,
+  GZ_EXTRA,
+  GZ_NAME,
+  GZ_COMMENT,
+  GZ_HCRC,
+  GZ_DONE
+};
+
+// gzip's CRC-32 (IEEE, reflected), nibble table to stay small in flash
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len) {
+  static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+      0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  crc = ~crc;
+  while (len--) {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ table[crc & 15];
+    crc = (crc >> 4) ^ table[crc & 15];
+  }
+  return ~crc;
+}
+
+bool WMOta::begin() {
+  abort();
+  _mode = MODE_DETECT;
+  _error = nullptr;
+  _digest[0] = '\0';
+  _received = _written = _heapPeak = 0;
+  _gzStage = GZ_FIXED;
+  _gzPos = _gzSkip = 0;
+  _trailerLen = 0;
+  _crc = 0;
+  _startMs = _endMs = millis();
+
+  if (!Update.begin(UPDATE_SIZE_UNKNOWN, U_FLASH))
+    return fail(Update.errorString());
+  mbedtls_sha256_init(&_sha);
+  mbedtls_sha256_starts(&_sha, 0);
+  _state = RUNNING;
+  return true;
+}
+
+bool WMOta::write(const uint8_t *data, size_t len) {
+  if (_state != RUNNING)
+    return false;
+  _received += len;
+
+  while (len > 0) {
+    size_t used = len;
+    switch (_mode) {
+    case MODE_DETECT:
+      // Application images start with 0xE9, gzip with 1F 8B
+      _mode = data[0] == 0x1F ? MODE_GZIP_HEADER : MODE_RAW;
+      continue;
+    case MODE_RAW:
+      if (!writeImage(data, len))
+        return false;
+      break;
+    case MODE_GZIP_HEADER:
+      used = parseGzipHeader(data, len);
+      break;
+    case MODE_INFLATE:
+      used = inflate(data, len);
+      break;
+    case MODE_TRAILER:
+      if (_trailerLen + len > sizeof(_trailer))
+        return fail("Data after end of gzip stream");
+      memcpy(_trailer + _trailerLen, data, len);
+      _trailerLen += len;
+      break;
+    }
+    if (_state != RUNNING)
+      return false;
+    data += used;
+    len -= used;
+  }
+  return true;
+}
+
+bool WMOta::end(const char *sha256Hex) {
+  if (_state != RUNNING)
+    return fail(_error ? _error : "No firmware uploaded");
+  _endMs = millis();
+  if (_written == 0)
+    return fail("Empty upload");
+  if (compressed()) {
+    if (_mode != MODE_TRAILER || _trailerLen != sizeof(_trailer))
+      return fail("Truncated gzip stream");
+    uint32_t crc = _trailer[0] | _trailer[1] << 8 | _trailer[2] << 16 |
+                   (uint32_t)_trailer[3] << 24;
+    uint32_t isize = _trailer[4] | _trailer[5] << 8 | _trailer[6] << 16 |
+                     (uint32_t)_trailer[7] << 24;
+    if (crc != _crc || isize != (uint32_t)_written)
+      return fail("gzip CRC mismatch");
+  }
+
+  uint8_t hash[32];
+  mbedtls_sha256_finish(&_sha, hash);
+  mbedtls_sha256_free(&_sha);
+  for (int i = 0; i < 32; i++)
+    snprintf(_digest + 2 * i, 3, "%02x", hash[i]);
+  if (sha256Hex && *sha256Hex && strcasecmp(sha256Hex, _digest) != 0)
+    return fail("SHA-256 mismatch");
+
+  if (!Update.end(true))
+    return fail(Update.errorString());
+  release();
+  _state = IDLE;
+  return true;
+}
+
+void WMOta::abort() {
+  if (_state == RUNNING) {
+    mbedtls_sha256_free(&_sha);
+    Update.abort();
+  }
+  release();
+  _state = IDLE;
+}
+
+bool WMOta::fail(const char *error) {
+  _error = error;
+  if (_state == RUNNING) {
+    mbedtls_sha256_free(&_sha);
+    Update.abort();
+  }
+  release();
+  _state = FAILED;
+  return false;
+}
+
+void WMOta::release() {
+  free(_inflator);
+  free(_window);
+  _inflator = nullptr;
+  _window = nullptr;
+}
+
+bool WMOta::writeImage(const uint8_t *data, size_t len) {
+  mbedtls_sha256_update(&_sha, data, len);
+  if (compressed())
+    _crc = crc32Update(_crc, data, len);
+  // Update::write() takes a non-const buffer but only copies from it
+  if (Update.write(const_cast<uint8_t *>(data), len) != len)
+    return fail(Update.errorString());
+  _written += len;
+  return true;
+}
+
+size_t WMOta::parseGzipHeader(const uint8_t *data, size_t len) {
+  size_t i = 0;
+  while (i < len && _gzStage != GZ_DONE) {
+    uint8_t c = data[i++];
+    bool fieldDone = false;
+    switch (_gzStage) {
+    case GZ_FIXED:
+      if ((_gzPos == 0 && c != 0x1F) || (_gzPos == 1 && c != 0x8B) ||
+          (_gzPos == 2 && c != 8)) {
+        fail("Not a firmware image or gzip stream");
+        return i;
+      }
+      if (_gzPos == 3)
+        _gzFlags = c;
+      fieldDone = ++_gzPos == 10;
+      break;
+    case GZ_EXTRA_LEN:
+      _gzSkip |= (uint16_t)c << (8 * _gzPos);
+      fieldDone = ++_gzPos == 2;
+      break;
+    case GZ_EXTRA:
+      fieldDone = --_gzSkip == 0;
+      break;
+    case GZ_NAME:
+    case GZ_COMMENT:
+      fieldDone = c == 0;
+      break;
+    case GZ_HCRC:
+      fieldDone = ++_gzPos == 2;
+      break;
+    }
+    if (fieldDone)
+      nextGzipStage();
+  }
+  if (_gzStage == GZ_DONE)
+    startInflate();
+  return i;
+}
+
+void WMOta::nextGzipStage() {
+  _gzPos = 0;
+  while (++_gzStage < GZ_DONE) {
+    if ((_gzStage == GZ_EXTRA_LEN && (_gzFlags & GZ_FEXTRA)) ||
+        (_gzStage == GZ_EXTRA && _gzSkip) ||
+        (_gzStage == GZ_NAME && (_gzFlags & GZ_FNAME)) ||
+        (_gzStage == GZ_COMMENT && (_gzFlags & GZ_FCOMMENT)) ||
+        (_gzStage == GZ_HCRC && (_gzFlags & GZ_FHCRC)))
+      return;
+  }
+}
+
+#ifdef WM_OTA_HAS_GZIP
+void WMOta::startInflate() {
+  // Only held while a compressed upload runs
+  _inflator = calloc(1, sizeof(tinfl_decompressor));
+  _window = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+  if (!_inflator || !_window) {
+    fail("Out of memory for gzip");
+    return;
+  }
+  _heapPeak = sizeof(tinfl_decompressor) + TINFL_LZ_DICT_SIZE;
+  tinfl_init((tinfl_decompressor *)_inflator);
+  _windowPos = 0;
+  _mode = MODE_INFLATE;
+}
+
+size_t WMOta::inflate(const uint8_t *data, size_t len) {
+  size_t consumed = 0;
+  while (true) {
+    size_t in = len - consumed;
+    size_t out = TINFL_LZ_DICT_SIZE - _windowPos;
+    tinfl_status status =
+        tinfl_decompress((tinfl_decompressor *)_inflator, data + consumed, &in, _window,
+                         _window + _windowPos, &out, TINFL_FLAG_HAS_MORE_INPUT);
+    consumed += in;
+    if (out > 0 && !writeImage(_window + _windowPos, out))
+      return consumed;
+    _windowPos = (_windowPos + out) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status == TINFL_STATUS_DONE) {
+      release(); // What follows is the 8-byte trailer
+      _mode = MODE_TRAILER;
+      return consumed;
+    }
+    if (status < 0 || (in == 0 && out == 0 && consumed < len)) {
+      fail("Corrupt gzip stream");
+      return consumed;
+    }
+    if (status == TINFL_STATUS_NEEDS_MORE_INPUT && consumed == len)
+      return consumed;
+  }
+}
+#else
+void WMOta::startInflate() {
+  fail("gzip images are not supported on this target");
+}
+
+size_t WMOta::inflate(const uint8_t *, size_t len) { return len; }
+#endif
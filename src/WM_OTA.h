@@ -0,0 +1,79 @@
+#ifndef WM_OTA_H
+#define WM_OTA_H
+
+#include "WM_Config.h"
+#include <Arduino.h>
+#include <mbedtls/sha256.h>
+
+/**
+ * Streaming firmware writer for the /update route.
+ *
+ * Upload bytes are written to the OTA partition as they arrive (Update
+ * stages them per flash sector), hashed with SHA-256 on the way and, when
+ * the stream starts with the gzip magic, inflated on the fly through a
+ * 32 KB window. Nothing is bootable until end() has checked the digest.
+ */
+class WMOta {
+public:
+  ~WMOta() { release(); }
+
+  bool begin();
+  bool write(const uint8_t *data, size_t len);
+  // Verifies the image (expected SHA-256 hex, or empty to skip) and marks
+  // it bootable. The partition is discarded on any failure.
+  bool end(const char *sha256Hex);
+  void abort();
+
+  bool active() const { return _state == RUNNING; }
+  const char *error() const { return _error; }
+  const char *digest() const { return _digest; } // Hex, valid after end()
+  size_t received() const { return _received; }   // Upload bytes
+  size_t written() const { return _written; }     // Image bytes
+  bool compressed() const { return _mode != MODE_DETECT && _mode != MODE_RAW; }
+  size_t heapPeak() const { return _heapPeak; }   // Inflate state, bytes
+  unsigned long elapsedMs() const { return _endMs - _startMs; }
+
+private:
+  enum State : uint8_t { IDLE, RUNNING, FAILED };
+  enum Mode : uint8_t {
+    MODE_DETECT,
+    MODE_RAW,
+    MODE_GZIP_HEADER,
+    MODE_INFLATE,
+    MODE_TRAILER
+  };
+
+  bool fail(const char *error);
+  bool writeImage(const uint8_t *data, size_t len);
+  // Both return the bytes they consumed; errors go through fail()
+  size_t parseGzipHeader(const uint8_t *data, size_t len);
+  void nextGzipStage();
+  void startInflate();
+  size_t inflate(const uint8_t *data, size_t len);
+  void release();
+
+  State _state = IDLE;
+  Mode _mode = MODE_DETECT;
+  const char *_error = nullptr;
+  mbedtls_sha256_context _sha;
+  char _digest[65] = "";
+  size_t _received = 0;
+  size_t _written = 0;
+  size_t _heapPeak = 0;
+  unsigned long _startMs = 0;
+  unsigned long _endMs = 0;
+
+  // gzip framing (RFC 1952): fixed header, optional fields, 8-byte trailer
+  uint8_t _gzFlags = 0;
+  uint8_t _gzStage = 0;
+  uint16_t _gzPos = 0;
+  uint16_t _gzSkip = 0;
+  uint8_t _trailer[8]; // CRC-32 and size of the inflated image
+  uint8_t _trailerLen = 0;
+  uint32_t _crc = 0;
+  void *_inflator = nullptr; // tinfl_decompressor (ESP32 ROM)
+  uint8_t *_window = nullptr; // TINFL_LZ_DICT_SIZE, wraps
+  size_t _windowPos = 0;
+};
+
+#endif
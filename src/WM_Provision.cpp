@@ -0,0 +1,150 @@
+#include "WM_Provision.h"
+
+// Copies a NUL- or end-terminated field; false when it does not fit
+static bool takeField(const uint8_t *&p, const uint8_t *end, char *out,
+                      size_t size) {
+  size_t n = 0;
+  while (p < end && *p) {
+    if (n + 1 >= size)
+      return false;
+    out[n++] = (char)*p++;
+  }
+  out[n] = '\0';
+  if (p < end)
+    p++; // Separator
+  return true;
+}
+
+uint16_t WMProvision::crc16(const uint8_t *data, size_t len, uint16_t crc) {
+  while (len--) {
+    crc ^= (uint16_t)*data++ << 8;
+    for (int i = 0; i < 8; i++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+size_t WMProvision::encode(uint8_t *out, uint8_t type, const uint8_t *data,
+                           size_t len) {
+  if (len > MAX_PAYLOAD)
+    len = MAX_PAYLOAD;
+  out[0] = SOF;
+  out[1] = type;
+  out[2] = (uint8_t)len;
+  out[3] = (uint8_t)(len >> 8);
+  if (len)
+    memcpy(out + 4, data, len);
+  uint16_t crc = crc16(out + 1, len + 3);
+  out[4 + len] = (uint8_t)crc;
+  out[5 + len] = (uint8_t)(crc >> 8);
+  return len + 6;
+}
+
+bool WMProvision::feed(uint8_t c) {
+  // A sender that gave up mid-frame must not swallow the next one
+  unsigned long now = millis();
+  if (_rx != RX_SYNC && now - _lastByte > WM_PROV_FRAME_TIMEOUT_MS)
+    _rx = RX_SYNC;
+  _lastByte = now;
+
+  switch (_rx) {
+  case RX_SYNC:
+    if (c == SOF)
+      _rx = RX_TYPE;
+    return false;
+  case RX_TYPE:
+    _type = c;
+    _rx = RX_LEN0;
+    return false;
+  case RX_LEN0:
+    _len = c;
+    _rx = RX_LEN1;
+    return false;
+  case RX_LEN1:
+    _len |= (uint16_t)c << 8;
+    _pos = 0;
+    _rx = _len > MAX_PAYLOAD ? RX_SYNC : _len ? RX_DATA : RX_CRC0;
+    return false;
+  case RX_DATA:
+    _data[_pos++] = c;
+    if (_pos == _len)
+      _rx = RX_CRC0;
+    return false;
+  case RX_CRC0:
+    _crc = c;
+    _rx = RX_CRC1;
+    return false;
+  case RX_CRC1: {
+    _crc |= (uint16_t)c << 8;
+    _rx = RX_SYNC;
+    uint8_t head[3] = {_type, (uint8_t)_len, (uint8_t)(_len >> 8)};
+    _valid = crc16(_data, _len, crc16(head, 3)) == _crc;
+    return true;
+  }
+  }
+  return false;
+}
+
+uint8_t WMProvision::stage() {
+  const uint8_t *p = _data;
+  const uint8_t *end = _data + _len;
+  WMProvisionBatch &b = _batch;
+
+  if (_type == BEGIN) {
+    memset(&b, 0, sizeof(b));
+    b.version = BATCH_VERSION;
+    _open = true;
+    return OK;
+  }
+  if (_type == ABORT) {
+    _open = false;
+    return OK;
+  }
+  if (!_open)
+    return ERR_STATE;
+
+  switch (_type) {
+  case NETWORK: {
+    // Slots arrive in order; resending the last one is fine
+    uint8_t slot = _len ? *p++ : 0xFF;
+    if (slot >= WM_MAX_NETWORKS || slot > b.count)
+      return ERR_ARG;
+    if (!takeField(p, end, b.ssid[slot], sizeof(b.ssid[slot])) ||
+        !b.ssid[slot][0] ||
+        !takeField(p, end, b.pass[slot], sizeof(b.pass[slot])))
+      return ERR_ARG;
+    if (slot == b.count)
+      b.count++;
+    b.sections |= SEC_NETWORKS;
+    return OK;
+  }
+  case STATIC_IP:
+    if (_len != 16)
+      return ERR_ARG;
+    memcpy(b.ip, p, 4);
+    memcpy(b.gateway, p + 4, 4);
+    memcpy(b.subnet, p + 8, 4);
+    memcpy(b.dns, p + 12, 4);
+    b.sections |= SEC_IP;
+    return OK;
+  case BSSID:
+    if (_len != 7)
+      return ERR_ARG;
+    memcpy(b.bssid, p, 6);
+    b.channel = p[6];
+    b.sections |= SEC_BSSID;
+    return OK;
+  case AP_NAME:
+    if (!takeField(p, end, b.apName, sizeof(b.apName)))
+      return ERR_ARG;
+    b.sections |= SEC_AP;
+    return OK;
+  case TIME:
+    if (!takeField(p, end, b.ntp, sizeof(b.ntp)) ||
+        !takeField(p, end, b.tz, sizeof(b.tz)))
+      return ERR_ARG;
+    b.sections |= SEC_TIME;
+    return OK;
+  }
+  return ERR_TYPE;
+}
@@ -0,0 +1,128 @@
+#ifndef WM_PROVISION_H
+#define WM_PROVISION_H
+
+#include "WM_Config.h"
+#include <Arduino.h>
+
+/**
+ * Framed serial provisioning (factory line).
+ *
+ * Frame, both directions:
+ *   A5 | type | length (u16 LE) | payload | CRC-16/CCITT-FALSE (u16 LE)
+ * The CRC covers type, length and payload. Every request gets one reply
+ * with the request type | 0x80 and a status byte first in the payload;
+ * a frame that fails its CRC gets a NAK (0xFF) and should be resent.
+ *
+ *   'B' begin     -                         -> status, STA MAC (6)
+ *   'N' network   slot, SSID, 0, password
+ *   'I' static IP ip, gateway, subnet, dns (4 bytes each, all 0 = DHCP)
+ *   'H' BSSID     bssid (6), channel (0 = any)
+ *   'A' AP name   name (empty = name given to begin())
+ *   'T' time      NTP server, 0, POSIX TZ (empty = WM_Config.h defaults)
+ *   'C' commit    flags (TEST, RESTART)
+ *   'S' status    -                         -> status, test result
+ *   'X' abort
+ *
+ * Requests are idempotent, so a lost reply can simply be retried; a
+ * repeated COMMIT answers OK again without re-applying. Only the sections a
+ * batch carries are written; networks replace all slots. The static IP and
+ * BSSID hint belong to the first network and are dropped when another
+ * network takes its place. A COMMIT during boot is journaled at once and
+ * applied when boot is done. This class frames and stages, WiFiManager
+ * stores and tests.
+ */
+
+// Everything one transaction can set. Also the NVS journal record
+// ("txn"), hence the version byte.
+struct WMProvisionBatch {
+  uint8_t version;
+  uint8_t sections; // WMProvision::SEC_* carried by this batch
+  uint8_t count;    // Networks, in priority order
+  uint8_t channel;
+  char ssid[WM_MAX_NETWORKS][33];
+  char pass[WM_MAX_NETWORKS][65];
+  uint8_t ip[4];
+  uint8_t gateway[4];
+  uint8_t subnet[4];
+  uint8_t dns[4];
+  uint8_t bssid[6];
+  char apName[33];
+  char ntp[65];
+  char tz[49];
+};
+
+class WMProvision {
+public:
+  static const uint8_t SOF = 0xA5;
+  static const uint16_t MAX_PAYLOAD = 128;
+  static const size_t MAX_FRAME = MAX_PAYLOAD + 6;
+  static const uint8_t BATCH_VERSION = 1;
+
+  enum : uint8_t {
+    BEGIN = 'B',
+    NETWORK = 'N',
+    STATIC_IP = 'I',
+    BSSID = 'H',
+    AP_NAME = 'A',
+    TIME = 'T',
+    COMMIT = 'C',
+    STATUS = 'S',
+    ABORT = 'X',
+    REPLY = 0x80,
+    NAK = 0xFF
+  };
+  enum : uint8_t {
+    OK,
+    ERR_CRC,
+    ERR_STATE, // No open batch, or a connection test is running
+    ERR_ARG,   // Bad length, field too long or slot out of order
+    ERR_TYPE,
+    ERR_STORE // NVS write failed
+  };
+  enum : uint8_t {
+    SEC_NETWORKS = 1 << 0,
+    SEC_IP = 1 << 1,
+    SEC_BSSID = 1 << 2,
+    SEC_AP = 1 << 3,
+    SEC_TIME = 1 << 4
+  };
+  enum : uint8_t { FLAG_TEST = 1 << 0, FLAG_RESTART = 1 << 1 }; // COMMIT
+  enum : uint8_t { TEST_NONE, TEST_RUNNING, TEST_PASSED, TEST_FAILED };
+
+  // Feeds one received byte; true once a whole frame is in (check valid())
+  bool feed(uint8_t c);
+  bool valid() const { return _valid; }
+  uint8_t type() const { return _type; }
+  const uint8_t *payload() const { return _data; }
+  uint16_t length() const { return _len; }
+
+  // Stages the current frame (B, N, I, H, A, T, X) into the open batch
+  uint8_t stage();
+  bool open() const { return _open; }
+  void close() { _open = false; }
+  WMProvisionBatch &batch() { return _batch; }
+
+  // Builds a frame into out (MAX_FRAME bytes), returns its size
+  static size_t encode(uint8_t *out, uint8_t type, const uint8_t *data,
+                       size_t len);
+  static uint16_t crc16(const uint8_t *data, size_t len,
+                        uint16_t crc = 0xFFFF);
+
+private:
+  enum Rx : uint8_t { RX_SYNC, RX_TYPE, RX_LEN0, RX_LEN1, RX_DATA, RX_CRC0,
+                      RX_CRC1 };
+
+  Rx _rx = RX_SYNC;
+  uint8_t _type = 0;
+  uint16_t _len = 0;
+  uint16_t _pos = 0;
+  uint16_t _crc = 0;
+  bool _valid = false;
+  unsigned long _lastByte = 0;
+  uint8_t _data[MAX_PAYLOAD];
+
+  bool _open = false;
+  WMProvisionBatch _batch;
+};
+
+#endif
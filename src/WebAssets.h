@@ -4,7 +4,7 @@
 #include <Arduino.h>
 
 const char WM_HTML_INDEX[] PROGMEM = R"rawliteral(
-<!DOCTYPE html><html lang="en"><head><meta charset="UTF-8" /><meta name="viewport" content="width=device-width, initial-scale=1.0" /><title>ESP32 WiFi Setup</title><style>:root{--primary-color:#2185d0;--text-color:#333;--bg-color:#f4f7f6;--segment-bg:#fff;--border-color:rgba(34,36,38,0.15);}body{background-color:var(--bg-color);font-family:"Lato","Helvetica Neue",Arial,Helvetica,sans-serif;color:var(--text-color);margin:0;padding:20px;display:flex;justify-content:center;align-items:center;min-height:100vh;}.ui.container{width:100%;max-width:450px;}.ui.segment{background:var(--segment-bg);border-radius:0.28571429rem;border:1px solid var(--border-color);box-shadow:0 1px 2px 0 rgba(34,36,38,0.15);padding:1.5em;margin-bottom:1em;}.ui.header{border-bottom:1px solid var(--border-color);margin-top:0;margin-bottom:1em;padding-bottom:0.5em;font-size:1.28571429rem;font-weight:700;color:var(--primary-color);}.ui.list{margin:1em 0;padding:0;list-style:none;}.wifi-item{display:flex;justify-content:space-between;align-items:center;padding:0.8em;border-bottom:1px solid #eee;cursor:pointer;transition:background 0.2s ease,border-left 0.2s ease;animation:slideIn 0.3s ease-out;min-height:48px;border-left:3px solid transparent;}.wifi-item:hover{background:#f9f9f9;}.wifi-item.selected{background:#e8f4fd;border-left-color:var(--primary-color);}.wifi-item:last-child{border-bottom:none;}.ui.button{background-color:var(--primary-color);color:white;border:none;padding:0.78571429em 1.5em;border-radius:0.28571429rem;font-weight:700;cursor:pointer;transition:background 0.2s ease,transform 0.1s ease;width:100%;}.ui.button:hover{background-color:#1678c2;transform:translateY(-1px);}.ui.button:active{transform:translateY(0);}.ui.button:disabled{background-color:#ccc;cursor:not-allowed;transform:none;}input[type="text"],input[type="password"]{width:100%;padding:0.67857143em 1em;border:1px solid var(--border-color);border-radius:0.28571429rem;box-sizing:border-box;margin-bottom:1em;font-size:16px;transition:border-color 0.2s ease,box-shadow 0.2s ease;}input[type="text"]:focus,input[type="password"]:focus{outline:none;border-color:var(--primary-color);box-shadow:0 0 0 2px rgba(33,133,208,0.1);}@keyframes slideIn{from{opacity:0;transform:translateX(-10px);}to{opacity:1;transform:translateX(0);}}.signal-strength{font-size:0.9em;color:#888;}</style></head><body><div class="ui container"><div class="ui segment"><h2 class="ui header">
+<!DOCTYPE html><html lang="en"><head><meta charset="UTF-8" /><meta name="viewport" content="width=device-width, initial-scale=1.0" /><title>ESP32 WiFi Setup</title><style>:root{--primary-color:#2185d0;--text-color:#333;--bg-color:#f4f7f6;--segment-bg:#fff;--border-color:rgba(34,36,38,0.15);}body{background-color:var(--bg-color);font-family:"Lato","Helvetica Neue",Arial,Helvetica,sans-serif;color:var(--text-color);margin:0;padding:20px;display:flex;justify-content:center;align-items:center;min-height:100vh;}.ui.container{width:100%;max-width:450px;}.ui.segment{background:var(--segment-bg);border-radius:0.28571429rem;border:1px solid var(--border-color);box-shadow:0 1px 2px 0 rgba(34,36,38,0.15);padding:1.5em;margin-bottom:1em;}.ui.header{border-bottom:1px solid var(--border-color);margin-top:0;margin-bottom:1em;padding-bottom:0.5em;font-size:1.28571429rem;font-weight:700;color:var(--primary-color);}.ui.list{margin:1em 0;padding:0;list-style:none;}.wifi-item{display:flex;justify-content:space-between;align-items:center;padding:0.8em;border-bottom:1px solid #eee;cursor:pointer;transition:background 0.2s ease,border-left 0.2s ease;min-height:48px;border-left:3px solid transparent;}.wifi-item:hover{background:#f9f9f9;}.wifi-item.selected{background:#e8f4fd;border-left-color:var(--primary-color);}.wifi-item:last-child{border-bottom:none;}.wifi-item.fresh{animation:slideIn 0.3s ease-out;}.wifi-placeholder{text-align:center;padding:1em;color:#888;}.wifi-info{flex-grow:1;}.wifi-ssid{font-weight:bold;}.wifi-security{font-size:0.8em;color:#999;}.wifi-signal{text-align:right;font-weight:bold;color:#21ba45;}.wifi-signal.fair{color:#fbbd08;}.wifi-signal.weak{color:#db2828;}.wifi-bars{font-size:1.2em;letter-spacing:-2px;}.wifi-dbm{font-size:0.75em;margin-top:2px;}.ui.button{background-color:var(--primary-color);color:white;border:none;padding:0.78571429em 1.5em;border-radius:0.28571429rem;font-weight:700;cursor:pointer;transition:background 0.2s ease,transform 0.1s ease;width:100%;}.ui.button:hover{background-color:#1678c2;transform:translateY(-1px);}.ui.button:active{transform:translateY(0);}.ui.button:disabled{background-color:#ccc;cursor:not-allowed;transform:none;}input[type="text"],input[type="password"]{width:100%;padding:0.67857143em 1em;border:1px solid var(--border-color);border-radius:0.28571429rem;box-sizing:border-box;margin-bottom:1em;font-size:16px;transition:border-color 0.2s ease,box-shadow 0.2s ease;}input[type="text"]:focus,input[type="password"]:focus{outline:none;border-color:var(--primary-color);box-shadow:0 0 0 2px rgba(33,133,208,0.1);}@keyframes slideIn{from{opacity:0;transform:translateX(-10px);}to{opacity:1;transform:translateX(0);}}.signal-strength{font-size:0.9em;color:#888;}</style></head><body><div class="ui container"><div class="ui segment"><h2 class="ui header">
           Select WiFi Network
           <button
             class="ui icon button basic mini"
@@ -12,7 +12,7 @@ const char WM_HTML_INDEX[] PROGMEM = R"rawliteral(
             id="refresh-btn"
           ><svg viewBox="0 0 24 24" width="16" height="16" fill="currentColor"><path
                 d="M12 4V1L8 5l4 4V6c3.31 0 6 2.69 6 6 0 1.01-.25 1.97-.7 2.8l1.46 1.46C19.54 15.03 20 13.57 20 12c0-4.42-3.58-8-8-8zm0 14c-3.31 0-6-2.69-6-6 0-1.01.25-1.97.7-2.8L5.24 7.74C4.46 8.97 4 10.43 4 12c0 4.42 3.58 8 8 8v3l4-4-4-4v3z"
-              /></svg></button></h2><p>Select a network or enter credentials manually.</p><div id="wifi-list" class="ui list"><div style="text-align: center; padding: 1em; color: #888"><span id="scanning-text">Scanning...</span></div></div><form action="/save" method="POST"><input
+              /></svg></button></h2><p>Select a network or enter credentials manually.</p><div id="wifi-list" class="ui list"><div id="wifi-placeholder" class="wifi-placeholder"><span id="scanning-text">Scanning...</span></div></div><form action="/save" method="POST"><input
             type="text"
             name="ssid"
             id="ssid"
@@ -23,7 +23,7 @@ const char WM_HTML_INDEX[] PROGMEM = R"rawliteral(
             name="password"
             id="password"
             placeholder="Password"
-          /><button type="submit" class="ui button">Connect</button></form></div></div><script>document.addEventListener("DOMContentLoaded", () => { const h = window.location.hostname; if ( h && h !== "192.168.4.1" && !h.endsWith(".local") && (h.includes("msftconnecttest") || h.includes("apple") || h.includes("google")) ) { window.location.href = "http://192.168.4.1/"; return; } const wifiList = document.getElementById("wifi-list"); const ssidInput = document.getElementById("ssid"); const foundNetworks = new Set(); const networkData = new Map(); let firstReceive = true; let lastNetworkCount = 0; let noChangeCount = 0; let pollInterval = null; let selectedSSID = null; const scanningText = document.getElementById("scanning-text"); document.getElementById("refresh-btn").onclick = (e) => { e.preventDefault(); wifiList.innerHTML = '<div style="text-align: center; padding: 1em; color: #888"><span id="scanning-text">Scanning...</span></div>'; foundNetworks.clear(); networkData.clear(); firstReceive = true; lastNetworkCount = 0; noChangeCount = 0; selectedSSID = null; ssidInput.value = ""; document.getElementById("password").value = ""; if (pollInterval) clearInterval(pollInterval); pollInterval = setInterval(fetchWifi, 1500); }; let scanDots = 0; setInterval(() => { if (document.getElementById("scanning-text")) { scanDots = (scanDots + 1) % 4; document.getElementById("scanning-text").innerText = "Scanning" + ".".repeat(scanDots); } }, 500); const fetchWifi = async () => { try { const response = await fetch("/list"); const networks = await response.json(); if (networks.length > 0 && firstReceive) { wifiList.innerHTML = ""; firstReceive = false; } networks.forEach((data) => { if (!foundNetworks.has(data.ssid)) { foundNetworks.add(data.ssid); networkData.set(data.ssid, data); } }); const sortedNetworks = Array.from(networkData.values()).sort( (a, b) => b.rssi - a.rssi ); if (sortedNetworks.length > 0 && firstReceive) { wifiList.innerHTML = ""; firstReceive = false; } if (sortedNetworks.length > 0) { wifiList.innerHTML = ""; sortedNetworks.forEach((data) => { const item = document.createElement("div"); item.className = "wifi-item"; if (selectedSSID === data.ssid) { item.classList.add("selected"); } let signalColor = "#21ba45"; let signalBars = "▂▄▆█"; if (data.rssi < -70) { signalColor = "#fbbd08"; signalBars = "▂▄▆"; } if (data.rssi < -85) { signalColor = "#db2828"; signalBars = "▂▄"; } item.innerHTML = ` <div style="flex-grow: 1;"> <div style="font-weight: bold;">${data.ssid}</div> <div style="font-size: 0.8em; color: #999;"> ${ data.secure === "true" ? "🔒 Secured" : "🔓 Open" } </div> </div> <div style="text-align: right; color:${signalColor}; font-weight: bold;"> <div style="font-size: 1.2em; letter-spacing: -2px;">${signalBars}</div> <div style="font-size: 0.75em; margin-top: 2px;">${ data.rssi } dBm</div> </div> `; item.onclick = () => { selectedSSID = data.ssid; document .querySelectorAll(".wifi-item") .forEach((el) => el.classList.remove("selected")); item.classList.add("selected"); ssidInput.value = data.ssid; document.getElementById("password").focus(); }; wifiList.appendChild(item); }); } const currentCount = foundNetworks.size; if (currentCount === lastNetworkCount && currentCount > 0) { noChangeCount++; if (noChangeCount >= 3) { console.log("No new networks found. Stopping scan."); clearInterval(pollInterval); pollInterval = null; } } else { noChangeCount = 0; } lastNetworkCount = currentCount; } catch (err) { console.error("Fetch error", err); } }; fetchWifi(); pollInterval = setInterval(fetchWifi, 1500); const form = document.querySelector("form"); form.onsubmit = async (e) => { e.preventDefault(); const btn = form.querySelector("button"); const originalText = btn.innerHTML; btn.disabled = true; btn.innerHTML = "Verifying Credentials..."; const formData = new FormData(form); const params = new URLSearchParams(); for (const pair of formData) { params.append(pair[0], pair[1]); } try { const response = await fetch("/save", { method: "POST", headers: { "Content-Type": "application/x-www-form-urlencoded" }, body: params, }); const result = await response.json(); if (result.status === "connected") { btn.style.backgroundColor = "#21ba45"; btn.innerHTML = "Success! Restarting..."; document.querySelector(".ui.segment").innerHTML = ` <h2 class="ui header" style="color: #21ba45">Connected!</h2> <p>Device is restarting to connect to <b style="color:#2185d0">${params.get( "ssid" )}</b>.</p> <p>Please reconnect your phone to your home WiFi.</p> <div class="ui active centered inline loader"></div> `; } else { throw new Error("Auth Failed"); } } catch (err) { btn.disabled = false; btn.style.backgroundColor = "#db2828"; btn.innerHTML = "Failed! Check Password"; setTimeout(() => { btn.style.backgroundColor = ""; btn.innerHTML = originalText; }, 3000); alert("Connection Failed! Please check your password and try again."); } }; });</script></body></html>
+          /><button type="submit" class="ui button">Connect</button></form></div></div><script>document.addEventListener("DOMContentLoaded", () => { const h = window.location.hostname; if ( h && h !== "192.168.4.1" && !h.endsWith(".local") && (h.includes("msftconnecttest") || h.includes("apple") || h.includes("google")) ) { window.location.href = "http://192.168.4.1/"; return; } const wifiList = document.getElementById("wifi-list"); const ssidInput = document.getElementById("ssid"); const placeholder = document.getElementById("wifi-placeholder"); const rows = new Map(); let lastNetworkCount = 0; let noChangeCount = 0; let pollInterval = null; let selectedSSID = null; document.getElementById("refresh-btn").onclick = (e) => { e.preventDefault(); wifiList.replaceChildren(placeholder); rows.clear(); lastNetworkCount = 0; noChangeCount = 0; selectedSSID = null; ssidInput.value = ""; document.getElementById("password").value = ""; if (pollInterval) clearInterval(pollInterval); pollInterval = setInterval(fetchWifi, 1500); }; let scanDots = 0; setInterval(() => { if (placeholder.isConnected) { scanDots = (scanDots + 1) % 4; document.getElementById("scanning-text").innerText = "Scanning" + ".".repeat(scanDots); } }, 500); const SCAN_TYPE = "application/x-wm-scan"; const utf8 = new TextDecoder(); const parseScan = (buf) => { const view = new DataView(buf); const list = []; if (view.byteLength < 2 || view.getUint8(0) !== 1) return list; let at = 2; for (let i = 0; i < view.getUint8(1) && at + 3 <= view.byteLength; i++) { const len = view.getUint8(at + 2); list.push({ rssi: view.getInt8(at), secure: (view.getUint8(at + 1) & 1) === 1, ssid: utf8.decode(new Uint8Array(buf, at + 3, len)), }); at += 3 + len; } return list; }; const signalLevel = (rssi) => rssi < -85 ? "weak" : rssi < -70 ? "fair" : "good"; const signalBars = { good: "▂▄▆█", fair: "▂▄▆", weak: "▂▄" }; const selectRow = (ssid) => { const prev = rows.get(selectedSSID); if (prev) prev.el.classList.remove("selected"); selectedSSID = ssid; rows.get(ssid).el.classList.add("selected"); ssidInput.value = ssid; document.getElementById("password").focus(); }; const createRow = (ssid) => { const el = document.createElement("div"); el.className = "wifi-item fresh"; el.innerHTML = '<div class="wifi-info"><div class="wifi-ssid"></div>' + '<div class="wifi-security"></div></div>' + '<div class="wifi-signal"><div class="wifi-bars"></div>' + '<div class="wifi-dbm"></div></div>'; el.querySelector(".wifi-ssid").textContent = ssid; el.addEventListener("animationend", () => el.classList.remove("fresh")); el.onclick = () => selectRow(ssid); return { el, rssi: null, secure: null, security: el.querySelector(".wifi-security"), signal: el.querySelector(".wifi-signal"), bars: el.querySelector(".wifi-bars"), dbm: el.querySelector(".wifi-dbm"), }; }; const patchRow = (row, data) => { if (row.rssi !== data.rssi) { const level = signalLevel(data.rssi); row.rssi = data.rssi; row.signal.className = "wifi-signal " + level; row.bars.textContent = signalBars[level]; row.dbm.textContent = data.rssi + " dBm"; } if (row.secure !== data.secure) { row.secure = data.secure; row.security.textContent = data.secure ? "🔒 Secured" : "🔓 Open"; } }; const render = (networks) => { networks.forEach((data) => { let row = rows.get(data.ssid); if (!row) { row = createRow(data.ssid); rows.set(data.ssid, row); } patchRow(row, data); }); if (rows.size === 0) return; if (placeholder.isConnected) placeholder.remove(); const sorted = Array.from(rows.values()).sort((a, b) => b.rssi - a.rssi); const items = wifiList.children; sorted.forEach((row, i) => { if (items[i] !== row.el) wifiList.insertBefore(row.el, items[i] || null); }); }; const fetchWifi = async () => { try { const response = await fetch("/list", { headers: { Accept: SCAN_TYPE }, }); const buf = await response.arrayBuffer(); const compact = (response.headers.get("Content-Type") || "").startsWith( SCAN_TYPE ); const networks = compact ? parseScan(buf) : JSON.parse(utf8.decode(buf)).map((n) => ({ ssid: n.ssid, rssi: n.rssi, secure: n.secure === true || n.secure === "true", })); const channel = response.headers.get("X-Scan-Channel"); const scanning = channel !== null && channel !== "0"; const t0 = performance.now(); render(networks); console.debug( `[scan] ${networks.length} networks, ${buf.byteLength} B ` + `${compact ? "compact" : "json"}, render ` + `${(performance.now() - t0).toFixed(2)} ms` ); const currentCount = rows.size; if (!scanning) { if (currentCount === lastNetworkCount && currentCount > 0) { noChangeCount++; if (noChangeCount >= 3) { console.log("No new networks found. Stopping scan."); clearInterval(pollInterval); pollInterval = null; } } else { noChangeCount = 0; } } lastNetworkCount = currentCount; } catch (err) { console.error("Fetch error", err); } }; fetchWifi(); pollInterval = setInterval(fetchWifi, 1500); const form = document.querySelector("form"); form.onsubmit = async (e) => { e.preventDefault(); const btn = form.querySelector("button"); const originalText = btn.innerHTML; btn.disabled = true; btn.innerHTML = "Verifying Credentials..."; const formData = new FormData(form); const params = new URLSearchParams(); for (const pair of formData) { params.append(pair[0], pair[1]); } try { const response = await fetch("/save", { method: "POST", headers: { "Content-Type": "application/x-www-form-urlencoded" }, body: params, }); const result = await response.json(); if (result.status === "connected") { btn.style.backgroundColor = "#21ba45"; btn.innerHTML = "Success! Restarting..."; document.querySelector(".ui.segment").innerHTML = ` <h2 class="ui header" style="color: #21ba45">Connected!</h2> <p>Device is restarting to connect to <b style="color:#2185d0">${params.get( "ssid" )}</b>.</p> <p>Please reconnect your phone to your home WiFi.</p> <div class="ui active centered inline loader"></div> `; } else { throw new Error("Auth Failed"); } } catch (err) { btn.disabled = false; btn.style.backgroundColor = "#db2828"; btn.innerHTML = "Failed! Check Password"; setTimeout(() => { btn.style.backgroundColor = ""; btn.innerHTML = originalText; }, 3000); alert("Connection Failed! Please check your password and try again."); } }; });</script></body></html>
 )rawliteral";
 
 #endif
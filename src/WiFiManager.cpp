@@ -4,9 +4,27 @@
 #include <WiFi.h>
 #include <functional>
 #include <time.h>
+#if defined(ESP_PLATFORM)
+#include <lwip/stats.h>
+#endif
 
 WiFiManager wifiManager;
 
+// Last boot fell back to the portal. Kept in RTC memory rather than NVS so
+// failed boots and /error polls never touch flash.
+static RTC_DATA_ATTR bool s_connError = false;
+
+// wifiTask -> waitConnected() signalling
+#define WM_EVT_CONNECTED (1 << 0)
+#define WM_EVT_PORTAL (1 << 1)
+
+// Compact /list payload, sent when the request's Accept names it:
+// [version][count] then per network [rssi:int8][flags][len][ssid bytes]
+#define WM_SCAN_TYPE "application/x-wm-scan"
+#define WM_SCAN_VERSION 1
+#define WM_SCAN_SECURE (1 << 0)
+static_assert(WM_SCAN_MAX_RESULTS <= 255, "/list count is one byte");
+
 WiFiManager::WiFiManager()
     : _server(80), _portalRunning(false), _shouldRestart(false),
       _taskHandle(nullptr) {}
@@ -14,6 +32,8 @@ WiFiManager::WiFiManager()
 WiFiManager::~WiFiManager() {
   if (_taskHandle)
     vTaskDelete(_taskHandle);
+  if (_events)
+    vEventGroupDelete(_events);
 }
 
 bool WiFiManager::begin(const char *apName, SimpleCallback onConnect) {
@@ -28,104 +48,356 @@ bool WiFiManager::begin(const char *apName, const char *apPassword) {
 
   WM_LOG("\n[WiFiManager] Starting...");
 
+  _booting = true; // Before wifiTask runs: provisioning waits for boot
+  startTask();
+  return runBoot();
+}
+
+bool WiFiManager::beginAsync(const char *apName, const char *apPassword) {
+  _apName = apName;
+  _apPassword = apPassword ? apPassword : "";
+  _isConnecting = true;
+
+  WM_LOG("\n[WiFiManager] Starting (async)...");
+
+  // The boot sequence is picked up by wifiTask on its next wakeup
+  _bootPending = true;
+  _booting = true; // Provisioning waits until the radio is ours
+  startTask();
+  return _taskHandle != nullptr;
+}
+
+bool WiFiManager::waitConnected(unsigned long timeoutMs) {
+  if (!_events)
+    return isConnected();
+
+  // Connected wins, even if a portal opened earlier in this boot
+  if (xEventGroupGetBits(_events) & WM_EVT_CONNECTED)
+    return true;
+
+  // Wake on either outcome: connected, or boot gave up and opened the portal
+  TickType_t ticks =
+      timeoutMs == WM_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+  EventBits_t bits = xEventGroupWaitBits(
+      _events, WM_EVT_CONNECTED | WM_EVT_PORTAL, pdFALSE, pdFALSE, ticks);
+  return (bits & WM_EVT_CONNECTED) != 0;
+}
+
+void WiFiManager::startTask() {
+  if (!_events)
+    _events = xEventGroupCreate();
+#if WM_LOG_LEVEL > WM_LOG_LEVEL_NONE
+  WMLog::begin();
+#endif
+
   if (!_taskHandle) {
     initTime();
     if (_ledPin == -1)
       setStatusLED();
     xTaskCreate(wifiTask, "wifi_task", 4096, this, 1, &_taskHandle);
   }
+}
+
+bool WiFiManager::runBoot() {
+  // Blocking begin(): step the sequence on the caller's task
+  startBoot();
+  while (_bootPhase != BOOT_IDLE)
+    vTaskDelay(pdMS_TO_TICKS(bootStep()));
+  return _bootConnected;
+}
+
+void WiFiManager::startBoot() {
+  _bootStart = millis();
+  _booting = true;
+  _bootConnected = false;
+  xEventGroupClearBits(_events, WM_EVT_CONNECTED | WM_EVT_PORTAL);
 
   // Try Auto-connecting to Last 3 Networks (Multi-Pass Retry)
-  Preferences prefs;
-  int bootRetries = 0;
-  String lastFailedSsid = "";
+  loadSettings();
+  _bootRetry = 0;
+  _bootSlot = 0;
+  _bootLastFailed = -1;
 
   WiFi.mode(WIFI_STA);
   WiFi.setSleep(false);
+  _bootPhase = BOOT_NEXT;
+}
 
-  while (bootRetries < WM_MAX_BOOT_RETRIES) {
-    if (bootRetries > 0) {
-      WM_LOGF("\n[WiFiManager] Boot Retry %d/%d in %d ms...\n", bootRetries + 1,
-              WM_MAX_BOOT_RETRIES, WM_BOOT_RETRY_DELAY_MS);
-      vTaskDelay(pdMS_TO_TICKS(WM_BOOT_RETRY_DELAY_MS));
+unsigned long WiFiManager::bootStep() {
+  // Every phase ends on a deadline; nothing here waits, so wifiTask keeps
+  // serving the LED, the app's server and provisioning between steps
+  unsigned long elapsed = millis() - _bootAt;
+  if (elapsed < _bootWait &&
+      (_bootPhase == BOOT_SETTLE || _bootPhase == BOOT_COOLDOWN))
+    return _bootWait - elapsed;
+
+  switch (_bootPhase) {
+  case BOOT_IDLE:
+    return 0;
+
+  case BOOT_NEXT:
+    for (; _bootSlot < WM_MAX_NETWORKS; _bootSlot++) {
+      const char *ssid = _settings.ssid[_bootSlot];
+      if (ssid[0] == '\0')
+        continue;
+      if (_bootRetry == 0 && _bootLastFailed >= 0 &&
+          strcmp(ssid, _settings.ssid[_bootLastFailed]) == 0) {
+        WM_LOGF("[WiFiManager] Skipping redundant attempt to %s\n", ssid);
+        continue; // Skip only on first pass if redundant
+      }
+      break;
     }
 
-    prefs.begin("wifi-manager", true); // Read-only
-    for (int i = 0; i < 3; i++) {
-      String keySsid = "s" + String(i);
-      String keyPass = "p" + String(i);
-
-      if (prefs.isKey(keySsid.c_str())) {
-        String ssid = prefs.getString(keySsid.c_str(), "");
-        String pass = prefs.getString(keyPass.c_str(), "");
-
-        if (ssid.length() > 0) {
-          if (ssid == lastFailedSsid && bootRetries == 0) {
-            WM_LOGF("[WiFiManager] Skipping redundant attempt to %s\n",
-                    ssid.c_str());
-            continue; // Skip only on first pass if redundant
-          }
-
-          WM_LOGF("[WiFiManager] Trying network %d: %s\n", i, ssid.c_str());
-          WiFi.disconnect();
-          vTaskDelay(pdMS_TO_TICKS(500));
-          WiFi.begin(ssid.c_str(), pass.c_str());
-
-          unsigned long startAttemptTime = millis();
-          while (millis() - startAttemptTime < WM_CONNECT_TIMEOUT_MS) {
-            if (WiFi.status() == WL_CONNECTED)
-              break;
-            vTaskDelay(pdMS_TO_TICKS(500));
-            WM_LOGF(".");
-          }
-
-          if (WiFi.status() == WL_CONNECTED) {
-            WM_LOG("\n[WiFiManager] Connected successfully!");
-            _isConnecting = false;
-            this->setSleep(true);
-
-            prefs.end();
-            prefs.begin("wifi-manager", false);
-            if (prefs.isKey("conn_error"))
-              prefs.remove("conn_error");
-            prefs.end();
-
-            if (_statusCallback)
-              _statusCallback(CONNECTED);
-            if (_connectedCb)
-              _connectedCb();
-            if (_callback)
-              _callback(true);
-            return true;
-          }
-
-          WM_LOG("\n[WiFiManager] Failed to connect to " + ssid);
-          lastFailedSsid = ssid;
-          vTaskDelay(pdMS_TO_TICKS(WM_CONNECT_COOLDOWN_MS));
-        }
+    if (_bootSlot == WM_MAX_NETWORKS) {
+      if (++_bootRetry >= WM_MAX_BOOT_RETRIES) {
+        finishBoot(false);
+        return 0;
       }
+      WM_LOGF("\n[WiFiManager] Boot Retry %d/%d in %d ms...\n", _bootRetry + 1,
+              WM_MAX_BOOT_RETRIES, WM_BOOT_RETRY_DELAY_MS);
+      _bootSlot = 0;
+      return bootWait(BOOT_COOLDOWN, WM_BOOT_RETRY_DELAY_MS);
     }
-    prefs.end();
-    bootRetries++;
+
+    WM_LOGF("[WiFiManager] Trying network %d: %s\n", _bootSlot,
+            _settings.ssid[_bootSlot]);
+    WiFi.disconnect();
+    return bootWait(BOOT_SETTLE, 500);
+
+  case BOOT_SETTLE:
+    beginNetwork(_settings.ssid[_bootSlot], _settings.pass[_bootSlot]);
+    bootWait(BOOT_CONNECTING, WM_CONNECT_TIMEOUT_MS);
+    return 0;
+
+  case BOOT_CONNECTING:
+    if (WiFi.status() == WL_CONNECTED) {
+      finishBoot(true);
+      return 0;
+    }
+    if (elapsed < _bootWait) {
+      unsigned long left = _bootWait - elapsed;
+      return left < 500 ? left : 500;
+    }
+    WM_LOGF("\n[WiFiManager] Failed to connect to %s\n",
+            _settings.ssid[_bootSlot]);
+    _bootLastFailed = _bootSlot++;
+    return bootWait(BOOT_COOLDOWN, WM_CONNECT_COOLDOWN_MS);
+
+  case BOOT_COOLDOWN:
+    _bootPhase = BOOT_NEXT;
+    return 0;
   }
+  return 0;
+}
 
+unsigned long WiFiManager::bootWait(BootPhase phase, unsigned long ms) {
+  _bootPhase = phase;
+  _bootAt = millis();
+  _bootWait = ms;
+  return ms;
+}
+
+void WiFiManager::finishBoot(bool connected) {
+  _bootPhase = BOOT_IDLE;
+  _bootConnected = connected;
   _isConnecting = false;
+
+  if (connected) {
+    WM_LOG("\n[WiFiManager] Connected successfully!");
+    WM_LOGF("[WiFiManager] Boot finished in %lu ms\n", millis() - _bootStart);
+    this->setSleep(true);
+
+    s_connError = false;
+    _wasConnected = true;
+    _booting = false;
+    xEventGroupSetBits(_events, WM_EVT_CONNECTED);
+
+    if (_statusCallback)
+      _statusCallback(CONNECTED);
+    if (_connectedCb)
+      _connectedCb();
+    if (_callback)
+      _callback(true);
+    return;
+  }
+
   startAP();
   startPortal();
+  WM_LOGF("[WiFiManager] Boot finished in %lu ms (portal)\n",
+          millis() - _bootStart);
+
+  _booting = false;
+  xEventGroupSetBits(_events, WM_EVT_PORTAL);
 
   if (_statusCallback)
     _statusCallback(PORTAL_START);
   if (_portalCb)
     _portalCb();
 
-  // Store Error Flag
-  prefs.begin("wifi-manager", false);
-  prefs.putBool("conn_error", true);
-  prefs.end();
+  // Store Error Flag (RTC memory, no flash write)
+  s_connError = true;
 
   if (_callback)
     _callback(false);
-  return false;
+}
+
+void WiFiManager::loadSettings() {
+  if (_settings.loaded)
+    return;
+
+  Preferences prefs;
+  prefs.begin("wifi-manager", true); // Read-only
+  for (int i = 0; i < WM_MAX_NETWORKS; i++) {
+    char keySsid[4] = {'s', (char)('0' + i), '\0'};
+    char keyPass[4] = {'p', (char)('0' + i), '\0'};
+    _settings.ssid[i][0] = '\0';
+    _settings.pass[i][0] = '\0';
+    if (prefs.isKey(keySsid)) {
+      prefs.getString(keySsid, _settings.ssid[i], sizeof(_settings.ssid[i]));
+      prefs.getString(keyPass, _settings.pass[i], sizeof(_settings.pass[i]));
+    }
+  }
+
+  // Provisioned extras; absent keys leave them zero/empty (isKey first,
+  // the core logs an error for every missing key read)
+  uint8_t ipv4[16] = {};
+  uint8_t hint[7] = {};
+  if (prefs.isKey("ip"))
+    prefs.getBytes("ip", ipv4, sizeof(ipv4));
+  if (prefs.isKey("bssid"))
+    prefs.getBytes("bssid", hint, sizeof(hint));
+  memcpy(_settings.ip, ipv4, 4);
+  memcpy(_settings.gateway, ipv4 + 4, 4);
+  memcpy(_settings.subnet, ipv4 + 8, 4);
+  memcpy(_settings.dns, ipv4 + 12, 4);
+  memcpy(_settings.bssid, hint, 6);
+  _settings.channel = hint[6];
+  _settings.netSsid[0] = _settings.apName[0] = _settings.ntp[0] =
+      _settings.tz[0] = '\0';
+  if (prefs.isKey("net"))
+    prefs.getString("net", _settings.netSsid, sizeof(_settings.netSsid));
+  if (prefs.isKey("ap"))
+    prefs.getString("ap", _settings.apName, sizeof(_settings.apName));
+  if (prefs.isKey("ntp"))
+    prefs.getString("ntp", _settings.ntp, sizeof(_settings.ntp));
+  if (prefs.isKey("tz"))
+    prefs.getString("tz", _settings.tz, sizeof(_settings.tz));
+
+  // A provisioning commit cut short by a reset is finished here
+  WMProvisionBatch &txn = _prov.batch();
+  size_t txnLen = prefs.isKey("txn") ? prefs.getBytesLength("txn") : 0;
+  bool replay = txnLen == sizeof(txn) &&
+                prefs.getBytes("txn", &txn, sizeof(txn)) == sizeof(txn) &&
+                txn.version == WMProvision::BATCH_VERSION;
+
+  // Older releases kept the error flag in flash; drop it once
+  bool legacyFlag = prefs.isKey("conn_error");
+  prefs.end();
+  if (legacyFlag) {
+    prefs.begin("wifi-manager", false);
+    prefs.remove("conn_error");
+    prefs.end();
+    _nvsErases++;
+  }
+
+  _settings.dirty = 0;
+  _settings.netDirty = false;
+  _settings.loaded = true;
+
+  if (replay) {
+    WM_LOG("[WiFiManager] Finishing interrupted provisioning commit");
+    prefs.begin("wifi-manager", false);
+    applyBatch(txn, prefs);
+    prefs.end();
+  } else if (txnLen) {
+    prefs.begin("wifi-manager", false); // Unknown layout, cannot replay
+    prefs.remove("txn");
+    prefs.end();
+    _nvsErases++;
+  }
+}
+
+void WiFiManager::storeCredentials(const char *ssid, const char *pass) {
+  loadSettings();
+
+  // Deduplicate and Shift: new network at slot 0, up to 2 others after it
+  char keepSsid[WM_MAX_NETWORKS - 1][33];
+  char keepPass[WM_MAX_NETWORKS - 1][65];
+  int count = 0;
+  for (int i = 0; i < WM_MAX_NETWORKS && count < WM_MAX_NETWORKS - 1; i++) {
+    if (_settings.ssid[i][0] != '\0' && strcmp(_settings.ssid[i], ssid) != 0) {
+      strcpy(keepSsid[count], _settings.ssid[i]);
+      strcpy(keepPass[count], _settings.pass[i]);
+      count++;
+    }
+  }
+
+  // The static IP and BSSID hint were provisioned for the old first
+  // network; a network saved from the portal must not inherit them
+  if (_settings.netSsid[0] && strcmp(ssid, _settings.netSsid) != 0)
+    clearNetworkExtras();
+
+  setSlot(0, ssid, pass);
+  for (int i = 0; i < count; i++)
+    setSlot(i + 1, keepSsid[i], keepPass[i]);
+}
+
+void WiFiManager::clearNetworkExtras() {
+  _settings.netSsid[0] = '\0';
+  memset(_settings.ip, 0, sizeof(_settings.ip));
+  memset(_settings.gateway, 0, sizeof(_settings.gateway));
+  memset(_settings.subnet, 0, sizeof(_settings.subnet));
+  memset(_settings.dns, 0, sizeof(_settings.dns));
+  memset(_settings.bssid, 0, sizeof(_settings.bssid));
+  _settings.channel = 0;
+  _settings.netDirty = true; // Keys go with the next commitSettings()
+}
+
+void WiFiManager::setSlot(int slot, const char *ssid, const char *pass) {
+  if (strcmp(_settings.ssid[slot], ssid) == 0 &&
+      strcmp(_settings.pass[slot], pass) == 0)
+    return; // Unchanged, nothing to write
+
+  strncpy(_settings.ssid[slot], ssid, sizeof(_settings.ssid[slot]) - 1);
+  _settings.ssid[slot][sizeof(_settings.ssid[slot]) - 1] = '\0';
+  strncpy(_settings.pass[slot], pass, sizeof(_settings.pass[slot]) - 1);
+  _settings.pass[slot][sizeof(_settings.pass[slot]) - 1] = '\0';
+  _settings.dirty |= 1 << slot;
+}
+
+void WiFiManager::commitSettings() {
+  if (!_settings.dirty && !_settings.netDirty)
+    return;
+
+  // One open for every slot changed since the last flush. Each put*() is
+  // still its own NVS write and commit (2 per slot), none for clean slots.
+  Preferences prefs;
+  prefs.begin("wifi-manager", false);
+  commitSettings(prefs);
+  prefs.end();
+}
+
+void WiFiManager::commitSettings(Preferences &prefs) {
+  for (int i = 0; i < WM_MAX_NETWORKS; i++) {
+    if (!(_settings.dirty & (1 << i)))
+      continue;
+    char keySsid[4] = {'s', (char)('0' + i), '\0'};
+    char keyPass[4] = {'p', (char)('0' + i), '\0'};
+    prefs.putString(keySsid, _settings.ssid[i]);
+    prefs.putString(keyPass, _settings.pass[i]);
+    _nvsWrites += 2;
+  }
+  if (_settings.netDirty) {
+    static const char *keys[] = {"net", "ip", "bssid"};
+    for (const char *key : keys) {
+      if (prefs.isKey(key)) {
+        prefs.remove(key);
+        _nvsErases++;
+      }
+    }
+    _settings.netDirty = false;
+  }
+  _settings.dirty = 0;
 }
 
 void WiFiManager::resetSettings(bool restart) {
@@ -133,12 +405,18 @@ void WiFiManager::resetSettings(bool restart) {
   prefs.begin("wifi-manager", false);
   prefs.clear();
   prefs.end();
+  _nvsErases++;
+
+  memset(&_settings, 0, sizeof(_settings));
+  _settings.loaded = true;
+  s_connError = false;
 
   WiFi.disconnect(true, true); // Clear STA config from Core + NVS
 
   if (restart) {
     WM_LOG("[WiFiManager] Settings reset. Restarting...");
     delay(1000);
+    WMLog::flush();
     ESP.restart();
   } else {
     WM_LOG("[WiFiManager] Settings reset. Entering Portal mode.");
@@ -162,10 +440,13 @@ void WiFiManager::startAP() {
   WM_LOG("[WiFiManager] Setting Mode: AP+STA");
   WiFi.mode(WIFI_AP_STA);
 
-  WM_LOGF("[WiFiManager] Starting SoftAP: %s\n", _apName.c_str());
+  // A provisioned AP name wins over the one given to begin()
+  loadSettings();
+  const char *apName =
+      _settings.apName[0] ? _settings.apName : _apName.c_str();
+  WM_LOGF("[WiFiManager] Starting SoftAP: %s\n", apName);
 
-  WiFi.softAP(_apName.c_str(),
-              _apPassword.length() > 0 ? _apPassword.c_str() : nullptr);
+  WiFi.softAP(apName, _apPassword.length() > 0 ? _apPassword.c_str() : nullptr);
 
   // Define Standard IP for Portal (192.168.4.1)
   IPAddress IP(192, 168, 4, 1);
@@ -174,22 +455,395 @@ void WiFiManager::startAP() {
   // Explicitly configure AP to ensure DHCP Server gives out this IP as DNS
   WiFi.softAPConfig(IP, IP, NMask);
 
-  WM_LOGF("[WiFiManager] AP Active: %s\n", _apName.c_str());
-  WM_LOGF("[WiFiManager] Portal IP: ");
-  WM_LOG(WiFi.softAPIP());
+  WM_LOGF("[WiFiManager] AP Active: %s\n", apName);
+  WM_LOGF("[WiFiManager] Portal IP: %s\n", WiFi.softAPIP().toString().c_str());
 
   _dnsServer.start(DNS_PORT, "*", WiFi.softAPIP());
 }
 
 WiFiManager &WiFiManager::useServer(WebServer *server) {
   _userServer = server;
+  addHistoryRoute();
+  // Mount now so portal routes sit ahead of routes the app adds afterwards
+  setupRoutes();
+  mountRouter(server);
+  return *this;
+}
+
+WiFiManager &WiFiManager::enableOTA(const char *user, const char *password) {
+  // The setup AP is open by default and the route outlives the portal:
+  // never flash without credentials
+  if (!password || !password[0]) {
+    WM_LOGE("[WiFiManager] OTA: a password is required, /update not added\n");
+    return *this;
+  }
+  _otaUser = user ? user : "";
+  _otaPass = password;
+  setupRoutes();
+  addUpdateRoute();
+  return *this;
+}
+
+void WiFiManager::addUpdateRoute() {
+  if (_otaEnabled)
+    return;
+  _router.onUpload(
+      "/update", [this]() { finishUpdate(); },
+      [this](HTTPUpload &upload) { handleUpload(upload); });
+  _otaEnabled = true;
+}
+
+bool WiFiManager::updateAuthorized() {
+  return _otaPass.length() > 0 &&
+         _http->authenticate(_otaUser.c_str(), _otaPass.c_str());
+}
+
+void WiFiManager::handleUpload(HTTPUpload &upload) {
+  switch (upload.status) {
+  case UPLOAD_FILE_START:
+    if (!updateAuthorized())
+      break; // finishUpdate() answers 401
+    WM_LOGF("[WiFiManager] OTA: receiving %s\n", upload.filename.c_str());
+    _ota.begin();
+    break;
+  case UPLOAD_FILE_WRITE:
+    _ota.write(upload.buf, upload.currentSize);
+    break;
+  case UPLOAD_FILE_END:
+    break; // Verified and committed in finishUpdate(), once args are parsed
+  case UPLOAD_FILE_ABORTED:
+    _ota.abort();
+    break;
+  }
+
+  // The body is read inside handleClient(): keep the captive DNS answering
+  // and the AP timeout from firing while a large image streams in
+  if (_portalRunning)
+    _dnsServer.processNextRequest();
+  _lastActivity = millis();
+}
+
+void WiFiManager::finishUpdate() {
+  if (!updateAuthorized()) {
+    _ota.abort();
+    _http->requestAuthentication();
+    return;
+  }
+  const char *expected = _router.arena.copy(_http->arg("sha256").c_str(), 64);
+  if (!_ota.end(expected)) {
+    WM_LOGE("[WiFiManager] OTA failed: %s\n", _ota.error());
+    _http->send(400, "text/plain", _ota.error());
+    return;
+  }
+
+  WM_LOGF("[WiFiManager] OTA: %u bytes (%u uploaded) in %lu ms, %lu KB/s\n",
+          (unsigned)_ota.written(), (unsigned)_ota.received(),
+          _ota.elapsedMs(),
+          (unsigned long)(_ota.received() /
+                          (_ota.elapsedMs() ? _ota.elapsedMs() : 1)));
+  _http->send(200, "text/plain", _router.arena.printf("OK %s", _ota.digest()));
+  _shouldRestart = true; // wifiTask restarts once the reply is out
+}
+
+WiFiManager &WiFiManager::enableSerialProvisioning(Stream &port) {
+  _provPort = &port;
   return *this;
 }
 
+void WiFiManager::serviceProvisioning() {
+  if (!_provPort)
+    return;
+  for (int n = _provPort->available(); n > 0; --n) {
+    int c = _provPort->read();
+    if (c >= 0 && _prov.feed((uint8_t)c))
+      handleProvisionFrame();
+  }
+  if (_provPending && !_booting) {
+    _provPending = false;
+    Preferences prefs;
+    prefs.begin("wifi-manager", false);
+    finishProvision(prefs);
+    prefs.end();
+  }
+  if (_provTest == WMProvision::TEST_RUNNING && !_provPending)
+    provisionTestStep();
+}
+
+void WiFiManager::sendProvision(uint8_t type, const uint8_t *data,
+                                size_t len) {
+  // One write per frame, so it cannot interleave with a log line
+  uint8_t frame[WMProvision::MAX_FRAME];
+  _provPort->write(frame, WMProvision::encode(frame, type, data, len));
+}
+
+void WiFiManager::handleProvisionFrame() {
+  uint8_t reply[7] = {WMProvision::OK};
+  size_t len = 1;
+  if (!_prov.valid()) {
+    reply[0] = WMProvision::ERR_CRC;
+    sendProvision(WMProvision::NAK, reply, len);
+    return;
+  }
+
+  switch (_prov.type()) {
+  case WMProvision::BEGIN:
+    // A batch still waiting for boot lives in the staging buffer
+    reply[0] = _provPending ? (uint8_t)WMProvision::ERR_STATE : _prov.stage();
+    if (reply[0] == WMProvision::OK)
+      _provCommitted = false;
+    WiFi.macAddress(reply + 1); // Unit ID for the line's records
+    len = 7;
+    break;
+  case WMProvision::COMMIT:
+    if (_prov.length() > 1)
+      reply[0] = WMProvision::ERR_ARG;
+    else
+      reply[0] = commitProvision(_prov.length() ? _prov.payload()[0] : 0);
+    break;
+  case WMProvision::STATUS:
+    reply[1] = _provTest;
+    len = 2;
+    break;
+  default:
+    reply[0] = _prov.stage();
+    break;
+  }
+  sendProvision(_prov.type() | WMProvision::REPLY, reply, len);
+}
+
+uint8_t WiFiManager::commitProvision(uint8_t flags) {
+  // A resend after a lost reply: the batch is already journaled
+  if (_provCommitted && !_prov.open())
+    return flags == _provFlags ? WMProvision::OK : WMProvision::ERR_STATE;
+  if (!_prov.open() || _provTest == WMProvision::TEST_RUNNING)
+    return WMProvision::ERR_STATE;
+  const WMProvisionBatch &b = _prov.batch();
+  loadSettings();
+  if ((flags & WMProvision::FLAG_TEST) && !b.count && !_settings.ssid[0][0])
+    return WMProvision::ERR_ARG; // Nothing to test
+
+  // Journal first: NVS writes a single entry atomically, so after a reset
+  // the batch is either absent or replayed in full by loadSettings().
+  // The same open then applies it, unless boot defers that.
+  Preferences prefs;
+  prefs.begin("wifi-manager", false);
+  if (prefs.putBytes("txn", &b, sizeof(b)) != sizeof(b)) {
+    prefs.end();
+    return WMProvision::ERR_STORE;
+  }
+  _nvsWrites++;
+  _prov.close();
+  _provCommitted = true;
+  _provFlags = flags;
+  if (flags & WMProvision::FLAG_TEST)
+    _provTest = WMProvision::TEST_RUNNING; // Reported by STATUS meanwhile
+  else
+    _provTest = WMProvision::TEST_NONE;
+
+  // Boot reads the settings cache on another task (blocking begin()):
+  // the journaled batch is applied once it is done
+  if (_booting)
+    _provPending = true;
+  else
+    finishProvision(prefs);
+  prefs.end();
+  return WMProvision::OK;
+}
+
+void WiFiManager::finishProvision(Preferences &prefs) {
+  const WMProvisionBatch &b = _prov.batch();
+  applyBatch(b, prefs);
+  WM_LOGF("[WiFiManager] Provisioned %d network(s), sections 0x%02x\n",
+          (int)b.count, (unsigned)b.sections);
+
+  if (b.sections & WMProvision::SEC_TIME)
+    initTime();
+
+  if (_provFlags & WMProvision::FLAG_TEST)
+    _provTestStarted = false; // Runs from wifiTask; the line does not wait
+  else if (_provFlags & WMProvision::FLAG_RESTART)
+    _shouldRestart = true;
+}
+
+void WiFiManager::applyBatch(const WMProvisionBatch &b, Preferences &prefs) {
+  // Networks replace every slot; other sections only when present
+  if (b.sections & WMProvision::SEC_NETWORKS) {
+    for (int i = 0; i < WM_MAX_NETWORKS; i++)
+      setSlot(i, i < b.count ? b.ssid[i] : "", i < b.count ? b.pass[i] : "");
+  }
+  // The static IP and BSSID hint belong to the first network; another
+  // network taking their place does not keep the previous one's
+  bool extras = b.sections & (WMProvision::SEC_IP | WMProvision::SEC_BSSID);
+  if (extras && strcmp(_settings.netSsid, _settings.ssid[0]) != 0)
+    clearNetworkExtras();
+  commitSettings(prefs);
+
+  if (extras && strcmp(_settings.netSsid, _settings.ssid[0]) != 0) {
+    strcpy(_settings.netSsid, _settings.ssid[0]);
+    prefs.putString("net", _settings.netSsid);
+    _nvsWrites++;
+  }
+  if (b.sections & WMProvision::SEC_IP) {
+    memcpy(_settings.ip, b.ip, 4);
+    memcpy(_settings.gateway, b.gateway, 4);
+    memcpy(_settings.subnet, b.subnet, 4);
+    memcpy(_settings.dns, b.dns, 4);
+    prefs.putBytes("ip", b.ip, 16); // ip, gateway, subnet, dns
+    _nvsWrites++;
+  }
+  if (b.sections & WMProvision::SEC_BSSID) {
+    uint8_t hint[7];
+    memcpy(hint, b.bssid, 6);
+    hint[6] = b.channel;
+    memcpy(_settings.bssid, b.bssid, 6);
+    _settings.channel = b.channel;
+    prefs.putBytes("bssid", hint, sizeof(hint));
+    _nvsWrites++;
+  }
+  if (b.sections & WMProvision::SEC_AP) {
+    strcpy(_settings.apName, b.apName);
+    prefs.putString("ap", b.apName);
+    _nvsWrites++;
+  }
+  if (b.sections & WMProvision::SEC_TIME) {
+    strcpy(_settings.ntp, b.ntp);
+    strcpy(_settings.tz, b.tz);
+    prefs.putString("ntp", b.ntp);
+    prefs.putString("tz", b.tz);
+    _nvsWrites += 2;
+  }
+  prefs.remove("txn");
+  _nvsErases++;
+}
+
+void WiFiManager::provisionTestStep() {
+  if (!_provTestStarted) {
+    if (_booting)
+      return; // Boot owns the radio until it connects or opens the portal
+    WM_LOGF("[WiFiManager] Testing provisioned network: %s\n",
+            _settings.ssid[0]);
+    WiFi.disconnect();
+    beginNetwork(_settings.ssid[0], _settings.pass[0]);
+    _provTestStart = millis();
+    _provTestStarted = true;
+    return;
+  }
+
+  wl_status_t status = WiFi.status();
+  if (status != WL_CONNECTED && status != WL_CONNECT_FAILED &&
+      millis() - _provTestStart < WM_CONNECT_TIMEOUT_MS)
+    return;
+
+  bool passed = status == WL_CONNECTED;
+  WM_LOGF("[WiFiManager] Provisioning test %s\n",
+          passed ? "passed" : "failed");
+  _provTest = passed ? WMProvision::TEST_PASSED : WMProvision::TEST_FAILED;
+  // Unsolicited STATUS reply, so a host that stayed attached sees it
+  uint8_t report[2] = {WMProvision::OK, _provTest};
+  sendProvision(WMProvision::STATUS | WMProvision::REPLY, report, 2);
+
+  if (passed) {
+    s_connError = false;
+    if (_provFlags & WMProvision::FLAG_RESTART)
+      _shouldRestart = true;
+    else if (_portalRunning)
+      _shouldStopPortal = true;
+  }
+}
+
+void WiFiManager::beginNetwork(const char *ssid, const char *pass) {
+  // Provisioned static address and BSSID/channel hint, for their network
+  // only; any other one goes back to DHCP
+  bool own = _settings.netSsid[0] && strcmp(ssid, _settings.netSsid) == 0;
+  if (_settings.ip[0])
+    WiFi.config(own ? IPAddress(_settings.ip) : IPAddress(),
+                own ? IPAddress(_settings.gateway) : IPAddress(),
+                own ? IPAddress(_settings.subnet) : IPAddress(),
+                own ? IPAddress(_settings.dns) : IPAddress());
+
+  static const uint8_t anyBssid[6] = {};
+  bool hint = own && memcmp(_settings.bssid, anyBssid, 6) != 0;
+  WiFi.begin(ssid, pass, hint ? _settings.channel : 0,
+             hint ? _settings.bssid : nullptr);
+}
+
+WiFiManager &WiFiManager::enableLinkHistory(unsigned long sampleMs) {
+  if (!_linkHistory.begin()) {
+    WM_LOGE("[WiFiManager] Link history: out of memory\n");
+    return *this;
+  }
+  WM_LOGF("[WiFiManager] Link history: %u bytes, sample every %lu ms\n",
+          (unsigned)_linkHistory.memoryUsage(), sampleMs);
+  _linkSampleMs = sampleMs > 0 ? sampleMs : WM_LINK_SAMPLE_MS;
+  addHistoryRoute();
+  return *this;
+}
+
+void WiFiManager::addHistoryRoute() {
+  if (_historyRouteAdded || !_userServer || !_linkHistory.active())
+    return;
+  _userServer->on("/wm/link.csv", HTTP_GET, [this]() { sendLinkCsv(); });
+  _historyRouteAdded = true;
+}
+
+void WiFiManager::sampleLink() {
+  bool connected = WiFi.status() == WL_CONNECTED;
+  WMLinkSample s;
+  s.rssi = connected ? WiFi.RSSI() : -127;
+  s.channel = connected ? WiFi.channel() : 0;
+  s.reconnects = _linkDrops;
+#if defined(ESP_PLATFORM) && LWIP_STATS && TCP_STATS
+  s.txRetries = lwip_stats.tcp.rexmit;
+#else
+  s.txRetries = 0; // lwIP built without TCP stats
+#endif
+  s.freeHeap = ESP.getFreeHeap();
+  _linkHistory.add(millis() / 1000, s);
+}
+
+void WiFiManager::sendLinkCsv() {
+  WebServer *server = _userServer;
+  int only = server->hasArg("tier") ? server->arg("tier").toInt() : -1;
+
+  // Streamed in small chunks: a full 7-day dump never sits in RAM
+  server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server->send(200, "text/csv", "");
+
+  char buf[512];
+  size_t len = snprintf(buf, sizeof(buf),
+                        "tier,time,samples,rssi_min,rssi_avg,rssi_max,channel,"
+                        "reconnects,tx_retries,heap_min_kb,heap_avg_kb,"
+                        "heap_max_kb\n");
+  for (int t = 0; t < WMLinkHistory::TIERS; t++) {
+    if (only >= 0 && only != t)
+      continue;
+    for (const WMLinkBucket &b : _linkHistory.tier(t)) {
+      if (len > sizeof(buf) - 96) {
+        server->sendContent(buf, len);
+        len = 0;
+      }
+      len += snprintf(buf + len, sizeof(buf) - len,
+                      "%d,%lu,%u,%d,%d,%d,%u,%u,%u,%u,%u,%u\n", t,
+                      (unsigned long)b.time, b.samples, b.rssiMin, b.rssiAvg,
+                      b.rssiMax, b.channel, b.reconnects, b.txRetries,
+                      b.heapMinKB, b.heapAvgKB, b.heapMaxKB);
+    }
+  }
+  if (len > 0)
+    server->sendContent(buf, len);
+  server->sendContent("", 0); // End of chunked response
+}
+
 void WiFiManager::stopPortal() {
   if (_portalRunning) {
+    xEventGroupClearBits(_events, WM_EVT_PORTAL); // waitConnected() waits again
     _dnsServer.stop();
-    _server.stop();
+    _router.enabled = false;
+    if (!_otaEnabled)
+      listen(false); // Otherwise stays up for /update
+    _scanChannel = 0;
+    _scanSliceRunning = false;
+    WiFi.scanDelete();
     WiFi.softAPdisconnect(true);
     WiFi.mode(WIFI_STA);
     _portalRunning = false;
@@ -205,16 +859,28 @@ void WiFiManager::stopPortal() {
 }
 
 void WiFiManager::startPortal() {
-  WM_LOG("[WiFiManager] Starting Portal in Standalone Mode...");
+  WM_LOGF("[WiFiManager] Starting Portal in %s Mode...\n",
+          _userServer ? "Middleware" : "Standalone");
 
   // บังคับปิดประหยัดพลังงานเพื่อให้ iPhone เชื่อมต่อได้เสถียร
   WiFi.setSleep(false);
 
-  setupRoutes();
-  _server.begin();
+  // Portal routes ride on whichever server is active: one socket, one poll
+  enablePortalRoutes(true);
+  listen(true);
   _portalRunning = true;
 }
 
+void WiFiManager::listen(bool on) {
+  if (_userServer || on == _serverUp)
+    return;
+  if (on)
+    _server.begin();
+  else
+    _server.stop();
+  _serverUp = on;
+}
+
 WiFiManager &WiFiManager::setStatusLED(int pin, bool activeLow) {
   _ledPin = pin;
   _ledInvert = activeLow;
@@ -289,7 +955,9 @@ bool WiFiManager::isTimeSynced() { return _timeSynced; }
 
 void WiFiManager::initTime() {
   WM_LOG("[WiFiManager] Initializing Time Synchronization...");
-  configTzTime(WM_TIME_ZONE, WM_NTP_SERVER);
+  loadSettings();
+  configTzTime(_settings.tz[0] ? _settings.tz : WM_TIME_ZONE,
+               _settings.ntp[0] ? _settings.ntp : WM_NTP_SERVER);
   _lastTimeSync = millis();
 }
 
@@ -314,32 +982,50 @@ bool WiFiManager::isConnected() { return WiFi.status() == WL_CONNECTED; }
 String WiFiManager::getSSID() { return WiFi.SSID(); }
 
 void WiFiManager::setupRoutes() {
-  _server.on("/", HTTP_GET, [this]() {
-    String host = _server.hostHeader();
-    String ip = WiFi.softAPIP().toString();
+  if (_routesReady)
+    return; // Table is built once, the router is toggled instead
+  _routesReady = true;
+
+  // Handlers take their scratch from _router.arena (reset after each
+  // response) instead of building Strings on the heap
+  _router.on("/", HTTP_GET, [this]() {
+    WMArena &a = _router.arena;
+    String host = _http->hostHeader();
+    const char *ip = portalIP();
     // Redirect to IP if accessing via fake domain (Captive Portal)
-    if (host.length() > 0 && host != ip && host != (ip + ":80")) {
-      WM_LOGF("[WebServer] Redirecting Host %s to IP %s\n", host.c_str(),
-              ip.c_str());
-      _server.sendHeader("Location", "http://" + ip + "/", true);
-      _server.send(302, "text/plain", "");
+    if (host.length() > 0 && host != ip && host != a.printf("%s:80", ip)) {
+      WM_LOGD("[WebServer] Redirecting Host %s to IP %s\n", host.c_str(), ip);
+      _http->sendHeader("Location", a.printf("http://%s/", ip), true);
+      _http->send(302, "text/plain", "");
       return;
     }
-    _server.send(200, "text/html", WM_HTML_INDEX);
+    _http->send(200, "text/html", WM_HTML_INDEX);
   });
 
-  _server.on("/save", HTTP_POST, [this]() {
-    if (_server.hasArg("ssid")) {
-      String s = _server.arg("ssid");
-      String p = _server.hasArg("password") ? _server.arg("password") : "";
+  // OS connectivity probes: bounce to the portal so the captive sheet opens
+  auto redirectToPortal = [this]() {
+    _http->sendHeader("Location", _router.arena.printf("http://%s/", portalIP()),
+                      true);
+    _http->send(302, "text/plain", "");
+  };
+
+  _router.on("/save", HTTP_POST, [this]() {
+    if (_http->hasArg("ssid")) {
+      // Copy out of the core's Strings so no heap block stays pinned
+      // across the connection test below
+      WMArena &a = _router.arena;
+      const char *s = a.copy(_http->arg("ssid").c_str(), 32);
+      const char *p =
+          _http->hasArg("password") ? a.copy(_http->arg("password").c_str(), 64)
+                                    : "";
 
       // --- Verify Credentials (Instant Feedback) ---
-      WM_LOGF("[WiFiManager] Testing connection to: %s\n", s.c_str());
+      WM_LOGF("[WiFiManager] Testing connection to: %s\n", s);
 
       // Start connection attempt (Clean start)
       WiFi.disconnect();
       vTaskDelay(pdMS_TO_TICKS(500));
-      WiFi.begin(s.c_str(), p.c_str());
+      beginNetwork(s, p);
 
       // Instead of blocked loop with recursive handleClient (which causes
       // crashes), we use a safe wait with yield.
@@ -361,185 +1047,326 @@ void WiFiManager::setupRoutes() {
 
       if (connected) {
         // Success! Save and Restart
-        Preferences prefs;
-        prefs.begin("wifi-manager", false);
-
-        // Deduplicate and Shift
-        struct WifiCreds {
-          String s;
-          String p;
-        };
-        WifiCreds list[3];
-        int count = 0;
-
-        // 1. Load current unique networks (excluding the one we just connected
-        // to)
-        for (int i = 0; i < 3; i++) {
-          String keyS = "s" + String(i);
-          String keyP = "p" + String(i);
-
-          if (prefs.isKey(keyS.c_str())) {
-            String curS = prefs.getString(keyS.c_str(), "");
-            String curP = prefs.getString(keyP.c_str(), "");
-            // Only add if it's not empty AND not the same as our new success
-            // SSID
-            if (curS.length() > 0 && curS != s && count < 2) {
-              list[count++] = {curS, curP};
-            }
-          }
-        }
-
-        // 2. Save "New" at Slot 0, and shifted ones after
-        prefs.putString("s0", s.c_str());
-        prefs.putString("p0", p.c_str());
-        for (int i = 0; i < count; i++) {
-          prefs.putString(("s" + String(i + 1)).c_str(), list[i].s.c_str());
-          prefs.putString(("p" + String(i + 1)).c_str(), list[i].p.c_str());
-        }
+        storeCredentials(s, p);
+        commitSettings();
 
         // Clear any previous error
-        if (prefs.isKey("conn_error"))
-          prefs.remove("conn_error");
-        prefs.end();
+        s_connError = false;
 
-        _server.send(200, "application/json", "{\"status\":\"connected\"}");
+        _http->send(200, "application/json", "{\"status\":\"connected\"}");
         _shouldStopPortal = true;
       } else {
         // Failed! Do NOT save, Do NOT restart
         WM_LOG("[WiFiManager] Connection Failed! Wrong password?");
-        _server.send(200, "application/json",
+        _http->send(200, "application/json",
                      "{\"status\":\"failed\", \"reason\":\"auth_error\"}");
       }
     } else {
-      _server.send(400, "text/plain", "Missing SSID");
+      _http->send(400, "text/plain", "Missing SSID");
     }
   });
 
-  _server.on("/hotspot-detect.html", HTTP_GET, [this]() {
-    String ip = WiFi.softAPIP().toString();
-    _server.sendHeader("Location", "http://" + ip + "/", true);
-    _server.send(302, "text/plain", "");
-  });
+  _router.on("/hotspot-detect.html", HTTP_GET, redirectToPortal);
 
-  _server.on("/error", HTTP_GET, [this]() {
-    Preferences prefs;
-    prefs.begin("wifi-manager", false); // Read-Write mode
-    bool err = prefs.getBool("conn_error", false);
-    if (err) {
-      if (prefs.isKey("conn_error"))
-        prefs.remove("conn_error"); // Consume the error
-    }
-    prefs.end();
-    _server.send(200, "text/plain", err ? "true" : "false");
+  _router.on("/error", HTTP_GET, [this]() {
+    bool err = s_connError;
+    s_connError = false; // Consume the error
+    _http->send(200, "text/plain", err ? "true" : "false");
   });
 
-  _server.on("/success.txt", HTTP_GET,
-             [this]() { _server.send(200, "text/plain", "success"); });
-  _server.on("/ncsi.txt", HTTP_GET, [this]() {
-    String ip = WiFi.softAPIP().toString();
-    _server.sendHeader("Location", "http://" + ip + "/", true);
-    _server.send(302, "text/plain", "");
-  });
-  _server.on("/connecttest.txt", HTTP_GET, [this]() {
-    String ip = WiFi.softAPIP().toString();
-    _server.sendHeader("Location", "http://" + ip + "/", true);
-    _server.send(302, "text/plain", "");
-  });
-  _server.on("/generate_204", HTTP_GET, [this]() {
-    String ip = WiFi.softAPIP().toString();
-    _server.sendHeader("Location", "http://" + ip + "/", true);
-    _server.send(302, "text/plain", "");
-  });
-  _server.on("/fwlink", HTTP_GET, [this]() {
-    String ip = WiFi.softAPIP().toString();
-    _server.sendHeader("Location", "http://" + ip + "/", true);
-    _server.send(302, "text/plain", "");
-  });
-  _server.on("/canonical.html", HTTP_GET, [this]() {
-    String ip = WiFi.softAPIP().toString();
-    _server.sendHeader("Location", "http://" + ip + "/", true);
-    _server.send(302, "text/plain", "");
-  });
+  _router.on("/success.txt", HTTP_GET,
+             [this]() { _http->send(200, "text/plain", "success"); });
+  _router.on("/ncsi.txt", HTTP_GET, redirectToPortal);
+  _router.on("/connecttest.txt", HTTP_GET, redirectToPortal);
+  _router.on("/generate_204", HTTP_GET, redirectToPortal);
+  _router.on("/fwlink", HTTP_GET, redirectToPortal);
+  _router.on("/canonical.html", HTTP_GET, redirectToPortal);
   // Handle Apple captive portal checks
-  _server.on("/library/test/success.html", HTTP_GET, [this]() {
-    _server.send(200, "text/html",
+  _router.on("/library/test/success.html", HTTP_GET, [this]() {
+    _http->send(200, "text/html",
                  "<HTML><HEAD><TITLE>Success</TITLE></HEAD><BODY>Success</"
                  "BODY></HTML>");
   });
 
-  _server.on("/list", HTTP_GET, [this]() {
-    WM_LOG("[WebServer] /list endpoint called");
-    int n = WiFi.scanComplete();
-    String json = "[";
-
-    if (n == WIFI_SCAN_FAILED || n == -2) {
-      // Start Scan (Async, All Channels)
-      WM_LOG("[WiFiManager] Starting background scan...");
-      WiFi.scanNetworks(true);
-    } else if (n >= 0) {
-      // We have results
-      WM_LOGF("[WiFiManager] Scan Completed. Found %d networks.\n", n);
-      bool first = true;
-      for (int i = 0; i < n; ++i) {
-        if (WiFi.RSSI(i) < _rssiThreshold)
-          continue; // Skip weak networks
-
-        if (!first)
-          json += ",";
-        json += "{";
-        json += "\"ssid\":\"" + WiFi.SSID(i) + "\",";
-        json += "\"rssi\":" + String(WiFi.RSSI(i)) + ",";
-        json +=
-            "\"secure\":" +
-            String(WiFi.encryptionType(i) != WIFI_AUTH_OPEN ? "true" : "false");
-        json += "}";
-        first = false;
-      }
+  _router.on("/list", HTTP_GET, [this]() {
+    WM_LOGD("[WebServer] /list endpoint called\n");
 
-      // Reset Activity Timer
-      _lastActivity = millis();
-      WiFi.scanDelete();
+    // Sweep runs channel by channel in wifiTask; serve what we have so far
+    // A finished sweep is served as is until it is WM_SCAN_MIN_AGE_MS old,
+    // so a polling page does not keep the radio off the AP channel
+    int sweepChannel = _scanChannel; // 0 = previous sweep finished
+    if (sweepChannel == 0 &&
+        (!_lastSweepEnd || millis() - _lastSweepEnd >= WM_SCAN_MIN_AGE_MS))
+      startScan();
 
-      // Trigger Next Scan (PASSIVE MODE)
-      // We do NOT start a new scan immediately here to prevent RF
-      // starvation/WDT resets. The next client poll (1.5s later) will find
-      // scanComplete() == -2 and trigger it then.
+    // Lets the portal keep polling until the sweep has covered every channel
+    WMArena &a = _router.arena;
+    const char *channel = a.printf("%d", sweepChannel);
+
+    // Reset Activity Timer
+    _lastActivity = millis();
+    _http->sendHeader("X-Scan-Channel", channel);
+
+    // Positional binary for the portal script: no repeated keys or
+    // escaping, about a third of the JSON size
+    if (_http->header("Accept").indexOf(WM_SCAN_TYPE) >= 0) {
+      size_t size = 2;
+      for (int i = 0; i < _scanCount; ++i)
+        size += 3 + strlen(_scanResults[i].ssid);
+      uint8_t *out = (uint8_t *)a.alloc(size);
+      if (out) {
+        uint8_t *p = out;
+        *p++ = WM_SCAN_VERSION;
+        *p++ = (uint8_t)_scanCount;
+        for (int i = 0; i < _scanCount; ++i) {
+          const ScanEntry &e = _scanResults[i];
+          size_t len = strlen(e.ssid);
+          *p++ = (uint8_t)e.rssi;
+          *p++ = e.secure ? WM_SCAN_SECURE : 0;
+          *p++ = (uint8_t)len;
+          memcpy(p, e.ssid, len);
+          p += len;
+        }
+        _http->send_P(200, WM_SCAN_TYPE, (const char *)out, size);
+        return;
+      }
+      // Arena too small for the table: fall through to the truncated JSON
     }
 
-    json += "]";
-    _server.send(200, "application/json", json);
+    // WM_ARENA_SIZE fits a full table; a smaller one truncates the list
+    WMArena::Text json = a.text(1);
+    json.add("[");
+    for (int i = 0; i < _scanCount && !json.overflow(); ++i) {
+      const ScanEntry &e = _scanResults[i];
+      json.addf("%s{\"ssid\":\"%s\",\"rssi\":%d,\"secure\":%s}",
+                i ? "," : "", e.ssid, (int)e.rssi, e.secure ? "true" : "false");
+    }
+    json.finish("]");
+    a.keep(json);
+    _http->send_P(200, "application/json", json.c_str(), json.length());
   });
 
-  _server.onNotFound([this]() {
-    String uri = _server.uri();
+  _router.onNotFound([this]() {
+    String uri = _http->uri();
     // ดักจับไฟล์ Icon และไฟล์อื่นๆ ที่ไม่จำเป็น
     if (uri.endsWith(".ico") || uri.endsWith(".png")) {
-      _server.send(404, "text/plain", "");
+      _http->send(404, "text/plain", "");
       return;
     }
-    WM_LOGF("[WebServer] Redirecting %s to Portal\n", uri.c_str());
-    String ip = WiFi.softAPIP().toString();
-    _server.sendHeader("Location", "http://" + ip + "/", true);
-    _server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-    _server.send(302, "text/plain", "");
+    WM_LOGD("[WebServer] Redirecting %s to Portal\n", uri.c_str());
+    _http->sendHeader("Location", _router.arena.printf("http://%s/", portalIP()),
+                      true);
+    _http->sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    _http->send(302, "text/plain", "");
   });
 }
 
+const char *WiFiManager::portalIP() {
+  IPAddress ip = WiFi.softAPIP();
+  return _router.arena.printf("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
 void WiFiManager::emitWiFiFound(int i) {
   // Logic moved to /list route for polling
 }
 
+void WiFiManager::mountRouter(WebServer *server) {
+  if (_http == server)
+    return;
+  if (_http) {
+    // A RequestHandler can only sit in one server's chain
+    WM_LOG("[WiFiManager] Router already mounted, call useServer() first");
+    return;
+  }
+  if (server == &_server) {
+    // The core only keeps headers it was told to collect. A shared server
+    // owns its own list, so there /list answers JSON unless the app adds
+    // "Accept" to its collectHeaders() call.
+    static const char *headers[] = {"Accept"};
+    server->collectHeaders(headers, 1);
+  }
+  server->addHandler(&_router);
+  _router.catchAll = server == &_server; // Nobody else serves there
+  _http = server;
+}
+
+WiFiManager &WiFiManager::enablePortalRoutes(bool enable) {
+  setupRoutes();
+  mountRouter(getServer());
+  _router.enabled = enable;
+  return *this;
+}
+
+void WiFiManager::PortalRouter::on(const char *uri, HTTPMethod method,
+                                   Handler fn) {
+  if (_count >= MAX_ROUTES)
+    return;
+  _routes[_count++] = {uri, method, fn, nullptr};
+}
+
+void WiFiManager::PortalRouter::onUpload(const char *uri, Handler fn,
+                                         UploadHandler ufn) {
+  if (_count >= MAX_ROUTES)
+    return;
+  _routes[_count++] = {uri, HTTP_POST, fn, ufn};
+}
+
+const WiFiManager::PortalRouter::Route *
+WiFiManager::PortalRouter::find(HTTPMethod method, const char *uri) const {
+  for (int i = 0; i < _count; i++) {
+    const Route &r = _routes[i];
+    if ((r.method == HTTP_ANY || r.method == method) &&
+        strcmp(r.uri, uri) == 0)
+      return &r;
+  }
+  return nullptr;
+}
+
+bool WiFiManager::PortalRouter::canHandle(HTTPMethod method, WM_URI_ARG uri) {
+  // While enabled: the portal routes (captive probes included), plus the
+  // catch-all on our own server. A shared server keeps the app's routes.
+  const Route *r = find(method, uri.c_str());
+  if (enabled)
+    return r || catchAll;
+  return r && r->ufn;
+}
+
+bool WiFiManager::PortalRouter::canUpload(WM_URI_ARG uri) {
+  const Route *r = find(HTTP_POST, uri.c_str());
+  return r && r->ufn;
+}
+
+void WiFiManager::PortalRouter::upload(WebServer &server, WM_URI_ARG uri,
+                                       HTTPUpload &upload) {
+  const Route *r = find(HTTP_POST, uri.c_str());
+  if (r && r->ufn)
+    r->ufn(upload);
+}
+
+bool WiFiManager::PortalRouter::handle(WebServer &server, HTTPMethod method,
+                                       WM_URI_ARG uri) {
+  const Route *match = find(method, uri.c_str());
+  bool mine = match ? enabled || match->ufn : enabled && catchAll;
+  if (!mine)
+    return false;
+  arena.reset();
+  if (match)
+    match->fn();
+  else if (_notFound)
+    _notFound();
+  arena.reset(); // The response is out, nothing in the arena is live
+  return true;
+}
+
+void WiFiManager::startScan() {
+  WM_LOGD("[WiFiManager] Starting incremental scan...\n");
+  for (int i = 0; i < _scanCount; ++i)
+    _scanResults[i].seen = false;
+  _scanChannel = 1;
+  _scanSliceRunning = false;
+  _lastScanSlice = 0;
+}
+
+void WiFiManager::scanStep() {
+  if (_scanChannel == 0)
+    return;
+
+  if (_scanSliceRunning) {
+    int n = WiFi.scanComplete();
+    if (n == WIFI_SCAN_RUNNING)
+      return;
+
+    _scanSliceRunning = false;
+    _lastScanSlice = millis();
+    if (n >= 0)
+      mergeScanSlice(n);
+    WiFi.scanDelete();
+
+    if (++_scanChannel > WM_SCAN_CHANNELS) {
+      // Sweep done: drop networks that did not show up on any channel
+      int kept = 0;
+      for (int i = 0; i < _scanCount; ++i)
+        if (_scanResults[i].seen)
+          _scanResults[kept++] = _scanResults[i];
+      _scanCount = kept;
+      _scanChannel = 0;
+      _lastSweepEnd = millis() | 1; // 0 = none yet
+      WM_LOGF("[WiFiManager] Scan Completed. Found %d networks.\n", kept);
+    }
+    return;
+  }
+
+  // Give the SoftAP time on its own channel between slices
+  if (_lastScanSlice != 0 && millis() - _lastScanSlice < WM_SCAN_SLICE_GAP_MS)
+    return;
+
+  if (WiFi.scanNetworks(true, false, false, WM_SCAN_DWELL_MS, _scanChannel) ==
+      WIFI_SCAN_FAILED) {
+    _lastScanSlice = millis(); // Retry the same channel after the gap
+    return;
+  }
+  _scanSliceRunning = true;
+}
+
+void WiFiManager::mergeScanSlice(int n) {
+  for (int i = 0; i < n; ++i) {
+    if (WiFi.RSSI(i) < _rssiThreshold)
+      continue; // Skip weak networks
+
+    String ssid = WiFi.SSID(i);
+    if (ssid.length() == 0)
+      continue;
+
+    // Same SSID on several channels/APs: keep the strongest
+    int slot = -1;
+    for (int j = 0; j < _scanCount; ++j) {
+      if (strcmp(_scanResults[j].ssid, ssid.c_str()) == 0) {
+        slot = j;
+        break;
+      }
+    }
+    if (slot < 0) {
+      if (_scanCount >= WM_SCAN_MAX_RESULTS)
+        continue;
+      slot = _scanCount++;
+      strncpy(_scanResults[slot].ssid, ssid.c_str(),
+              sizeof(_scanResults[slot].ssid) - 1);
+      _scanResults[slot].ssid[sizeof(_scanResults[slot].ssid) - 1] = '\0';
+    } else if (_scanResults[slot].seen &&
+               _scanResults[slot].rssi >= WiFi.RSSI(i)) {
+      continue;
+    }
+
+    ScanEntry &e = _scanResults[slot];
+    e.rssi = WiFi.RSSI(i);
+    e.channel = WiFi.channel(i);
+    e.secure = WiFi.encryptionType(i) != WIFI_AUTH_OPEN;
+    e.seen = true;
+  }
+}
+
 void WiFiManager::wifiTask(void *pvParameters) {
   WiFiManager *instance = (WiFiManager *)pvParameters;
 
-  TickType_t lastScanTime = 0;
   unsigned long apStartTime = millis();
   const unsigned long AP_TIMEOUT = WM_DEFAULT_AP_TIMEOUT; // From WM_Config.h
 
   while (true) {
+    // Deferred Boot Sequence (beginAsync), one step per pass
+    if (instance->_bootPending) {
+      instance->_bootPending = false;
+      instance->startBoot();
+      instance->_bootInTask = true;
+    }
+    if (instance->_bootInTask) {
+      instance->bootStep();
+      instance->_bootInTask = instance->_bootPhase != BOOT_IDLE;
+    }
+
     // Safe Restart Check (Manual via resetSettings)
     if (instance->_shouldRestart) {
       vTaskDelay(pdMS_TO_TICKS(2000));
+      WMLog::flush();
       ESP.restart();
     }
 
@@ -569,37 +1396,61 @@ void WiFiManager::wifiTask(void *pvParameters) {
       static unsigned long lastClientCheck = 0;
       if (millis() - lastClientCheck > 5000) {
         int numClients = WiFi.softAPgetStationNum();
-        WM_LOGF("[WiFiManager] AP Clients Connected: %d \n", numClients);
+        WM_LOGD("[WiFiManager] AP Clients Connected: %d \n", numClients);
         lastClientCheck = millis();
       }
 
-      instance->_server.handleClient();
-      if (instance->_userServer)
-        instance->_userServer->handleClient();
       instance->_dnsServer.processNextRequest();
     }
 
+    // Factory provisioning frames and the deferred connection test
+    instance->serviceProvisioning();
+
+    // Single listener: the user's server (portal mounted on it) or our own,
+    // which /update keeps up once the station connects
+    if (instance->_userServer) {
+      instance->_userServer->handleClient();
+    } else {
+      if (instance->_otaEnabled && WiFi.status() == WL_CONNECTED)
+        instance->listen(true);
+      if (instance->_serverUp)
+        instance->_server.handleClient();
+    }
+
     // 2. Smooth Background Scanning (Non-blocking)
-    // REMOVED: Scanning is now driven by /list endpoint on demand.
+    // Started by /list, advanced one channel slice at a time.
+    if (instance->_portalRunning)
+      instance->scanStep();
 
     // 3. Background Time Sync
     instance->checkTimeSync();
 
+    // 3b. Link Quality Sampling (opt-in, fixed memory)
+    if (instance->_linkSampleMs &&
+        millis() - instance->_lastLinkSample >= instance->_linkSampleMs) {
+      instance->_lastLinkSample = millis();
+      instance->sampleLink();
+    }
+
     // 4. Monitor WiFi Status & LED Management
-    static bool lastConnected = false;
     bool currentlyConnected = (WiFi.status() == WL_CONNECTED);
 
-    // Trigger Callbacks
-    if (!instance->_portalRunning && currentlyConnected != lastConnected) {
-      lastConnected = currentlyConnected;
+    // Trigger Callbacks (boot reports its own result)
+    if (!instance->_booting && !instance->_portalRunning &&
+        currentlyConnected != instance->_wasConnected) {
+      instance->_wasConnected = currentlyConnected;
       if (currentlyConnected) {
         instance->_isConnecting = false;
+        xEventGroupClearBits(instance->_events, WM_EVT_PORTAL);
+        xEventGroupSetBits(instance->_events, WM_EVT_CONNECTED);
         if (instance->_statusCallback)
           instance->_statusCallback(CONNECTED);
         if (instance->_connectedCb)
           instance->_connectedCb();
       } else {
         instance->_isConnecting = true;
+        instance->_linkDrops++;
+        xEventGroupClearBits(instance->_events, WM_EVT_CONNECTED);
         if (instance->_statusCallback)
           instance->_statusCallback(DISCONNECTED);
         if (instance->_disconnectedCb)
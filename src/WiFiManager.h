@@ -1,21 +1,27 @@
 #ifndef WIFI_MANAGER_H
 #define WIFI_MANAGER_H
 
+#include "WM_Arena.h"
 #include "WM_Config.h"
+#include "WM_LinkHistory.h"
+#include "WM_Log.h"
+#include "WM_OTA.h"
+#include "WM_Provision.h"
 #include <Arduino.h>
 #include <DNSServer.h>
 #include <WebServer.h>
 #include <WiFi.h>
+#include <freertos/event_groups.h>
 #include <functional>
 #include <time.h>
 
-// Debug Macros
-#ifdef DEBUG_MODE
-#define WM_LOG(x) Serial.println(x)
-#define WM_LOGF(x, ...) Serial.printf(x, ##__VA_ARGS__)
+class Preferences;
+
+// RequestHandler signatures changed to const String& in core 3.x
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+#define WM_URI_ARG const String &
 #else
-#define WM_LOG(x)
-#define WM_LOGF(x, ...)
+#define WM_URI_ARG String
 #endif
 
 class WiFiManager {
@@ -23,9 +29,14 @@ public:
   WiFiManager();
   ~WiFiManager();
 
-  // Middleware Mode
+  // Middleware Mode. From here on the WiFiManager task owns the server: it
+  // calls handleClient() every loop, portal up or not, so the sketch must
+  // not (WebServer is not safe to poll from two tasks).
   WiFiManager &useServer(WebServer *server);
   WebServer *getServer() { return _userServer ? _userServer : &_server; }
+  // Portal + captive-probe routes as one group; started/stopped with the
+  // portal, or toggled manually (e.g. to reconfigure from the dashboard).
+  WiFiManager &enablePortalRoutes(bool enable);
 
   // Callbacks & Types
   enum WiFiState { CONNECTED, DISCONNECTED, PORTAL_START, PORTAL_TIMEOUT };
@@ -37,6 +48,12 @@ public:
   bool begin(const char *apName = WM_DEFAULT_AP_NAME,
              const char *apPassword = WM_DEFAULT_AP_PASSWORD);
   bool begin(const char *apName, SimpleCallback onConnect);
+  // Returns immediately; the boot-connect sequence runs inside wifiTask and
+  // reports through the usual callbacks and waitConnected().
+  bool beginAsync(const char *apName = WM_DEFAULT_AP_NAME,
+                  const char *apPassword = WM_DEFAULT_AP_PASSWORD);
+  // Blocks until connected (true), the portal opens or the timeout expires
+  bool waitConnected(unsigned long timeoutMs = WM_WAIT_FOREVER);
   void resetSettings(bool restart = true);
   void clearSettings();
 
@@ -98,17 +115,111 @@ public:
   time_t getTimestamp();
   bool isTimeSynced();
 
+  // Link Quality History (RSSI, channel, drops, retries, heap)
+  // Served as CSV at /wm/link.csv on the useServer() server.
+  WiFiManager &enableLinkHistory(unsigned long sampleMs = WM_LINK_SAMPLE_MS);
+  const WMLinkHistory &linkHistory() { return _linkHistory; }
+
+  // Firmware update: POST /update with a multipart file (.bin or .bin.gz,
+  // optional sha256=<hex>), streamed to the OTA partition. Served by the
+  // useServer() server, or in standalone mode by our own server on port 80,
+  // which then keeps listening (just /update) while the station is up.
+  // Always behind Basic auth: without a non-empty password /update is not
+  // registered. The device restarts into the new image.
+  WiFiManager &enableOTA(const char *user, const char *password);
+
+  // Factory provisioning over a serial port (framed protocol, see
+  // WM_Provision.h): a batch of networks, static IP, BSSID hint, AP name
+  // and NTP/timezone are committed to NVS in one transaction, optionally
+  // followed by a background connection test. WiFiManager reads the port
+  // from then on, so the sketch must not.
+  WiFiManager &enableSerialProvisioning(Stream &port = Serial);
+
+  // Flash wear counters (NVS key writes / erases since boot)
+  unsigned long getNVSWrites() { return _nvsWrites; }
+  unsigned long getNVSErases() { return _nvsErases; }
+
 private:
+  friend class WiFiManagerBench; // bench/bench_main.cpp
+
   // Internal methods
   static void wifiTask(void *pvParameters);
+  void startTask();
+  bool runBoot();
+  void startBoot();
+  unsigned long bootStep(); // ms until the next step has work to do
+  void finishBoot(bool connected);
   void startAP();
   void startPortal();
   void stopPortal();
+  void listen(bool on); // Our own server (standalone mode)
   void setupRoutes();
+  void mountRouter(WebServer *server);
+  const char *portalIP(); // Dotted SoftAP IP in the request arena
   void emitWiFiFound(int i);
+  void loadSettings();
+  void storeCredentials(const char *ssid, const char *pass);
+  void setSlot(int slot, const char *ssid, const char *pass);
+  void commitSettings();
+  void commitSettings(Preferences &prefs); // Namespace already open
+  void addHistoryRoute();
+  void sampleLink();
+  void sendLinkCsv();
+  void addUpdateRoute();
+  bool updateAuthorized();
+  void handleUpload(HTTPUpload &upload);
+  void finishUpdate();
+  void serviceProvisioning();
+  void handleProvisionFrame();
+  uint8_t commitProvision(uint8_t flags);
+  void finishProvision(Preferences &prefs);
+  void applyBatch(const WMProvisionBatch &b, Preferences &prefs);
+  void clearNetworkExtras();
+  void provisionTestStep();
+  void sendProvision(uint8_t type, const uint8_t *data, size_t len);
+  void beginNetwork(const char *ssid, const char *pass);
+  void startScan();
+  void scanStep();
+  void mergeScanSlice(int n);
+
+  // Portal routes in one RequestHandler, so they can be mounted on any
+  // server and switched on/off together.
+  class PortalRouter : public RequestHandler {
+  public:
+    typedef std::function<void()> Handler;
+    typedef std::function<void(HTTPUpload &)> UploadHandler;
+    void on(const char *uri, HTTPMethod method, Handler fn);
+    // POST upload route; stays reachable while the portal routes are off
+    void onUpload(const char *uri, Handler fn, UploadHandler ufn);
+    void onNotFound(Handler fn) { _notFound = fn; }
+    bool canHandle(HTTPMethod method, WM_URI_ARG uri) override;
+    bool handle(WebServer &server, HTTPMethod method, WM_URI_ARG uri) override;
+    bool canUpload(WM_URI_ARG uri) override;
+    void upload(WebServer &server, WM_URI_ARG uri,
+                HTTPUpload &upload) override;
+    bool enabled = false;
+    bool catchAll = false; // Unmatched URIs go to onNotFound() when enabled
+    WMArena arena; // Handler scratch, reset after every response
+
+  private:
+    static const int MAX_ROUTES = 16;
+    struct Route {
+      const char *uri;
+      HTTPMethod method;
+      Handler fn;
+      UploadHandler ufn;
+    };
+    const Route *find(HTTPMethod method, const char *uri) const;
+    Route _routes[MAX_ROUTES];
+    int _count = 0;
+    Handler _notFound;
+  };
 
   // Components
   WebServer _server;
+  WebServer *_http = nullptr; // Server the router is mounted on
+  PortalRouter _router;
+  bool _routesReady = false;
   WebServer *_userServer = nullptr;
   DNSServer _dnsServer;
   ConnectionCallback _callback = nullptr;
@@ -124,17 +235,88 @@ private:
   String _apName;
   String _apPassword;
   bool _portalRunning = false;
+  bool _serverUp = false; // _server is listening
   bool _sleepEnabled = true; // Default as set in constructor or begin
   bool _shouldRestart = false;
   bool _shouldStopPortal = false;
   bool _isConnecting = false;
+  bool _bootPending = false; // beginAsync() hand-off to wifiTask
+  bool _booting = false;
+  bool _wasConnected = false;
+
+  // Boot Sequence (slot / attempt / cooldown, stepped against deadlines)
+  enum BootPhase : uint8_t {
+    BOOT_IDLE,
+    BOOT_NEXT,       // Pick the next slot, or the next pass
+    BOOT_SETTLE,     // After disconnect, before WiFi.begin()
+    BOOT_CONNECTING, // Until connected or WM_CONNECT_TIMEOUT_MS
+    BOOT_COOLDOWN    // Between attempts and between passes
+  };
+  unsigned long bootWait(BootPhase phase, unsigned long ms);
+  BootPhase _bootPhase = BOOT_IDLE;
+  bool _bootInTask = false; // Stepped by wifiTask (beginAsync)
+  bool _bootConnected = false;
+  int _bootSlot = 0;
+  int _bootRetry = 0;
+  int _bootLastFailed = -1;
+  unsigned long _bootStart = 0;
+  unsigned long _bootAt = 0;   // Current phase start
+  unsigned long _bootWait = 0; // Current phase length
   TaskHandle_t _taskHandle = nullptr;
+  EventGroupHandle_t _events = nullptr;
 
   int _ledPin = -1;
   bool _ledInvert = false;
   int _ledPulseHold = WM_LED_PULSE_HOLD; // Default active time (ms)
   const byte DNS_PORT = WM_DNS_PORT;
 
+  // Settings Cache (write-behind copy of the "wifi-manager" namespace)
+  struct Settings {
+    char ssid[WM_MAX_NETWORKS][33];
+    char pass[WM_MAX_NETWORKS][65];
+    // Provisioned extras (zero/empty = not set). The static IP and the
+    // BSSID/channel hint only apply to the network named in netSsid.
+    char netSsid[33];
+    uint8_t ip[4];
+    uint8_t gateway[4];
+    uint8_t subnet[4];
+    uint8_t dns[4];
+    uint8_t bssid[6];
+    uint8_t channel;
+    char apName[33];
+    char ntp[65];
+    char tz[49];
+    uint8_t dirty;  // Bit per slot changed since the last commit
+    bool netDirty;  // Network extras dropped, keys still in NVS
+    bool loaded;
+  };
+  Settings _settings = {};
+  unsigned long _nvsWrites = 0;
+  unsigned long _nvsErases = 0;
+
+  // Link History
+  WMLinkHistory _linkHistory;
+  unsigned long _linkSampleMs = 0; // 0 = disabled
+  unsigned long _lastLinkSample = 0;
+  uint32_t _linkDrops = 0;
+  bool _historyRouteAdded = false;
+
+  // Firmware Update
+  WMOta _ota;
+  String _otaUser;
+  String _otaPass;
+  bool _otaEnabled = false;
+
+  // Serial Provisioning
+  WMProvision _prov;
+  Stream *_provPort = nullptr;
+  uint8_t _provTest = WMProvision::TEST_NONE;
+  uint8_t _provFlags = 0;         // COMMIT flags of the last batch
+  bool _provCommitted = false;    // Since the last BEGIN (duplicate COMMIT)
+  bool _provPending = false;      // Journaled, applied once boot is done
+  unsigned long _provTestStart = 0;
+  bool _provTestStarted = false; // Waits for boot to finish first
+
   // Time Sync Members
   unsigned long _lastTimeSync = 0;
   bool _timeSynced = false;
@@ -143,8 +325,20 @@ private:
 
   // Advanced Configuration
 
-  // Scanning State
+  // Scanning State (one channel per slice, 0 = idle)
+  struct ScanEntry {
+    char ssid[33];
+    int8_t rssi;
+    uint8_t channel;
+    bool secure;
+    bool seen; // Found during the current sweep
+  };
+  ScanEntry _scanResults[WM_SCAN_MAX_RESULTS];
+  int _scanCount = 0;
   int _scanChannel = 0;
+  bool _scanSliceRunning = false;
+  unsigned long _lastScanSlice = 0;
+  unsigned long _lastSweepEnd = 0; // 0 = no sweep finished yet
 
   // Advanced Settings
   int _rssiThreshold = WM_DEFAULT_RSSI_THRESHOLD;
@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""Factory provisioning over the WiFiManager serial protocol.
+
+Provisions one unit after another on the same port: waits for a unit that
+has not been seen yet (by MAC), sends the batch, commits and reports the
+time per unit and the units-per-minute rate. Frames are described in
+src/WM_Provision.h. Needs only the Python standard library.
+
+  python3 tools/wm_provision.py /dev/ttyUSB0 \\
+      --network Factory:secret --network Backup:secret2 \\
+      --static-ip 10.0.0.50,10.0.0.1,255.255.255.0,10.0.0.1 \\
+      --ap-name "Sensor-{mac}" --tz "ICT-7" --test --units 50
+
+Against the host simulator (bench/bench_main.cpp):
+  ./wm_bench --pty 200 &    # prints /dev/pts/N
+  python3 tools/wm_provision.py /dev/pts/N --network Line:secret --units 200
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+SOF = 0xA5
+REPLY = 0x80
+NAK = 0xFF
+MAX_PAYLOAD = 128
+
+BEGIN, NETWORK, STATIC_IP, BSSID, AP_NAME, TIME, COMMIT, STATUS = (
+    ord(c) for c in "BNIHATCS")
+FLAG_TEST, FLAG_RESTART = 1, 2
+STATUS_TEXT = ["ok", "crc error", "bad state", "bad argument", "unknown type",
+               "store failed"]
+TEST_TEXT = ["none", "running", "passed", "failed"]
+
+BAUDS = {9600: termios.B9600, 57600: termios.B57600,
+         115200: termios.B115200, 230400: termios.B230400,
+         460800: termios.B460800, 921600: termios.B921600}
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, as WMProvision::crc16."""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xFFFF
+    return crc
+
+
+def frame(ftype, payload=b""):
+    body = struct.pack("<BH", ftype, len(payload)) + payload
+    return bytes([SOF]) + body + struct.pack("<H", crc16(body))
+
+
+class ProvisionError(Exception):
+    pass
+
+
+class Port:
+    def __init__(self, path, baud):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        if baud in BAUDS:
+            attrs = termios.tcgetattr(self.fd)
+            attrs[4] = attrs[5] = BAUDS[baud]
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.buf = bytearray()
+
+    def read_frame(self, timeout):
+        """Next valid frame as (type, payload), skipping log text."""
+        deadline = time.monotonic() + timeout
+        while True:
+            parsed = self._parse()
+            if parsed:
+                return parsed
+            left = deadline - time.monotonic()
+            if left <= 0:
+                return None
+            if select.select([self.fd], [], [], left)[0]:
+                self.buf += os.read(self.fd, 512)
+
+    def _parse(self):
+        while True:
+            start = self.buf.find(SOF)
+            if start < 0:
+                self.buf.clear()
+                return None
+            del self.buf[:start]
+            if len(self.buf) < 4:
+                return None
+            ftype, length = struct.unpack_from("<BH", self.buf, 1)
+            if length > MAX_PAYLOAD:
+                del self.buf[:1]
+                continue
+            if len(self.buf) < length + 6:
+                return None
+            body = bytes(self.buf[1:4 + length])
+            (crc,) = struct.unpack_from("<H", self.buf, 4 + length)
+            if crc16(body) != crc:
+                del self.buf[:1]  # A stray 0xA5, resync on the next one
+                continue
+            del self.buf[:length + 6]
+            return ftype, body[3:]
+
+    def request(self, ftype, payload=b"", timeout=0.5, retries=3):
+        """Sends a request, returns the reply payload after the status."""
+        for _ in range(retries + 1):
+            os.write(self.fd, frame(ftype, payload))
+            deadline = time.monotonic() + timeout
+            while True:
+                reply = self.read_frame(max(0, deadline - time.monotonic()))
+                if reply is None or reply[0] == NAK:
+                    break  # Resend
+                rtype, data = reply
+                if rtype == ftype | REPLY and data:
+                    if data[0]:
+                        raise ProvisionError("%s: %s" % (
+                            chr(ftype), STATUS_TEXT[data[0]]
+                            if data[0] < len(STATUS_TEXT) else data[0]))
+                    return data[1:]
+                # Anything else (a late test report) is skipped
+        raise ProvisionError("%s: no reply" % chr(ftype))
+
+
+def ipv4(text):
+    parts = [int(p) for p in text.split(".")]
+    if len(parts) != 4 or not all(0 <= p <= 255 for p in parts):
+        raise argparse.ArgumentTypeError("bad IPv4 address: " + text)
+    return bytes(parts)
+
+
+def build_batch(args, mac):
+    """Request frames (type, payload) for one unit."""
+    reqs = []
+    for slot, net in enumerate(args.network):
+        ssid, _, password = net.partition(":")
+        reqs.append((NETWORK, bytes([slot]) + ssid.encode() + b"\0" +
+                     password.encode()))
+    if args.static_ip:
+        fields = args.static_ip.split(",")
+        if len(fields) == 3:
+            fields.append(fields[1])  # DNS defaults to the gateway
+        reqs.append((STATIC_IP, b"".join(ipv4(f) for f in fields)))
+    if args.bssid:
+        addr, _, channel = args.bssid.partition("@")
+        reqs.append((BSSID, bytes.fromhex(addr.replace(":", "")) +
+                     bytes([int(channel or 0)])))
+    if args.ap_name is not None:
+        name = args.ap_name.replace("{mac}", mac[-3:].hex().upper())
+        reqs.append((AP_NAME, name.encode()))
+    if args.ntp is not None or args.tz is not None:
+        reqs.append((TIME, (args.ntp or "").encode() + b"\0" +
+                     (args.tz or "").encode()))
+    return reqs
+
+
+def wait_for_unit(port, seen):
+    """Polls BEGIN until a unit with a new MAC answers; returns the MAC."""
+    while True:
+        try:
+            mac = bytes(port.request(BEGIN, timeout=0.2, retries=0))
+            if len(mac) == 6 and mac not in seen:
+                return mac
+        except ProvisionError:
+            pass
+        time.sleep(0.05)
+
+
+def wait_test(port, timeout):
+    """Polls STATUS until the deferred test has a result."""
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        state = port.request(STATUS)[0]
+        if state != 1:
+            return TEST_TEXT[state]
+        # The unit also reports the result by itself when the test ends
+        left = max(0, deadline - time.monotonic())
+        reply = port.read_frame(min(0.25, left))
+        if reply and reply[0] == STATUS | REPLY and len(reply[1]) == 2:
+            return TEST_TEXT[reply[1][1]]
+    return "running"
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("port")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--network", action="append", default=[],
+                    metavar="SSID:PASS", help="repeat in priority order")
+    ap.add_argument("--static-ip", metavar="IP,GATEWAY,SUBNET[,DNS]",
+                    help="for the first network")
+    ap.add_argument("--bssid", metavar="AA:BB:CC:DD:EE:FF[@CHANNEL]",
+                    help="hint for the first network")
+    ap.add_argument("--ap-name", help="{mac} expands to the last 3 MAC bytes")
+    ap.add_argument("--ntp")
+    ap.add_argument("--tz", help="POSIX TZ string, e.g. ICT-7")
+    ap.add_argument("--test", action="store_true",
+                    help="deferred connection test after the commit")
+    ap.add_argument("--wait-test", type=float, default=0, metavar="SECONDS",
+                    help="wait this long for the test result per unit")
+    ap.add_argument("--restart", action="store_true",
+                    help="restart into the new settings")
+    ap.add_argument("--units", type=int, default=0, help="0 = until Ctrl-C")
+    args = ap.parse_args()
+
+    port = Port(args.port, args.baud)
+    flags = (FLAG_TEST if args.test else 0) | \
+        (FLAG_RESTART if args.restart else 0)
+    seen = set()
+    started = None
+    failed = 0
+    try:
+        while not args.units or len(seen) < args.units:
+            mac = wait_for_unit(port, seen)
+            t0 = time.monotonic()
+            started = started or t0
+            try:
+                for ftype, payload in build_batch(args, mac):
+                    port.request(ftype, payload)
+                port.request(COMMIT, bytes([flags]))
+                result = "committed"
+                if args.test and args.wait_test:
+                    result = "test " + wait_test(port, args.wait_test)
+            except ProvisionError as e:
+                result = "FAILED (%s)" % e
+                failed += 1
+            seen.add(mac)
+            print("unit %4d  %s  %-22s %6.1f ms" % (
+                len(seen), mac.hex(":"), result,
+                (time.monotonic() - t0) * 1000), flush=True)
+    except KeyboardInterrupt:
+        pass
+
+    if seen:
+        secs = time.monotonic() - started
+        print("%d units (%d failed) in %.2f s: %.1f units/min" % (
+            len(seen), failed, secs, len(seen) * 60 / secs if secs else 0))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())